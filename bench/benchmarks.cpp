@@ -0,0 +1,230 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "../include/game_engine.h"
+#include "../include/npc_factory.h"
+#include "../include/npc.h"
+#include "../include/npc_world.h"
+#include "../include/rng.h"
+#include "../include/simd_kernels.h"
+#include "../include/spatial_grid.h"
+#include "../include/visitor.h"
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t BENCH_SEED = 42;
+
+// Сторона карты растёт как sqrt(N): плотность, а значит и число боёв на NPC,
+// одинакова для всех размеров.
+double mapSideFor(size_t count) {
+    return 10.0 * sqrt(static_cast<double>(count));
+}
+
+vector<shared_ptr<NPC>> makeNpcs(size_t count, double side) {
+    RngStream rng = RngService::stream(BENCH_SEED, RngDomain::SPAWN, 0);
+    vector<shared_ptr<NPC>> npcs;
+    npcs.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        auto type = static_cast<NPCFactory::NPCType>(i % NPC_KIND_COUNT);
+        npcs.push_back(NPCFactory::construct(type, "NPC_" + to_string(i),
+                                             rng.uniform(0.0, side), rng.uniform(0.0, side)));
+    }
+    return npcs;
+}
+
+// Печать итогов движка не должна попадать в вывод бенчмарка.
+class SilenceCout {
+private:
+    ostringstream sink;
+    streambuf* saved;
+
+public:
+    SilenceCout() : saved(cout.rdbuf(sink.rdbuf())) {}
+    ~SilenceCout() { cout.rdbuf(saved); }
+};
+
+}
+
+static void BM_CalculateDistance(benchmark::State& state) {
+    Squirrel a("A", 10.0, 20.0);
+    Werewolf b("B", 40.0, 60.0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a.calculateDistance(&b));
+    }
+}
+BENCHMARK(BM_CalculateDistance);
+
+static void BM_NpcMove(benchmark::State& state) {
+    auto npcs = makeNpcs(static_cast<size_t>(state.range(0)), 100.0);
+    for (auto _ : state) {
+        for (auto& npc : npcs) {
+            npc->move(0.0, 100.0, 0.0, 100.0);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NpcMove)->Arg(1000)->Arg(10000);
+
+static void BM_SimdMoveBlock(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    RngStream rng = RngService::stream(BENCH_SEED, RngDomain::MOVEMENT, 0);
+    vector<double> xs(count), ys(count), dx(count), dy(count), step(count, 1.0), outX(count), outY(count);
+    for (size_t i = 0; i < count; i++) {
+        xs[i] = rng.uniform(0.0, 100.0);
+        ys[i] = rng.uniform(0.0, 100.0);
+        dx[i] = rng.uniform(-1.0, 1.0);
+        dy[i] = rng.uniform(-1.0, 1.0);
+    }
+    simd::Bounds bounds{0.0, 100.0, 0.0, 100.0};
+    for (auto _ : state) {
+        simd::moveBlock(xs.data(), ys.data(), dx.data(), dy.data(), step.data(),
+                        outX.data(), outY.data(), count, bounds);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(simd::backendName(simd::activeBackend()));
+}
+BENCHMARK(BM_SimdMoveBlock)->Arg(1000)->Arg(100000);
+
+// Поиск боёв объектным DetectionVisitor по сетке, как в старом пути движка.
+static void BM_DetectBattles(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    double side = mapSideFor(count);
+    auto npcs = makeNpcs(count, side);
+    SpatialGrid grid(0.0, side, 0.0, side, 10.0);
+    for (size_t i = 0; i < npcs.size(); i++) {
+        grid.insert(i, npcs[i]->getX(), npcs[i]->getY());
+    }
+
+    size_t tasks = 0;
+    for (auto _ : state) {
+        BattleQueue queue(1, true);
+        for (auto& npc : npcs) {
+            DetectionVisitor visitor(npcs, queue, npc, &grid);
+            visitor.detectBattles();
+        }
+        tasks = queue.size();
+        benchmark::DoNotOptimize(tasks);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["tasks"] = static_cast<double>(tasks);
+}
+BENCHMARK(BM_DetectBattles)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// Пакетная постановка и разбор задач; аргументы — число шардов и размер пакета.
+static void BM_BattleQueueThroughput(benchmark::State& state) {
+    size_t shards = static_cast<size_t>(state.range(0));
+    size_t batchSize = static_cast<size_t>(state.range(1));
+    vector<BattleTask> batch;
+    for (size_t i = 0; i < batchSize; i++) {
+        batch.emplace_back(i, i + 1);
+    }
+    BattleQueue queue(shards, true);
+    vector<BattleTask> drained;
+    for (auto _ : state) {
+        queue.addTasks(batch);
+        // Пустая очередь заставила бы drainInto ждать работу — берём ровно пакет.
+        size_t remaining = batchSize;
+        for (size_t worker = 0; remaining > 0; worker = (worker + 1) % shards) {
+            drained.clear();
+            size_t taken = queue.drainInto(drained, 64, worker);
+            queue.completeTasks(taken);
+            remaining -= taken;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_BattleQueueThroughput)->Args({1, 1024})->Args({4, 1024})->Args({4, 16384});
+
+static void BM_FactorySaveText(benchmark::State& state) {
+    auto npcs = makeNpcs(static_cast<size_t>(state.range(0)), 500.0);
+    string filename = "bench_npcs.txt";
+    SilenceCout silence;
+    for (auto _ : state) {
+        NPCFactory::saveToFile(npcs, filename);
+    }
+    remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FactorySaveText)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// Аргументы — число NPC и потоков разбора.
+static void BM_FactoryLoadText(benchmark::State& state) {
+    string filename = "bench_npcs.txt";
+    SilenceCout silence;
+    NPCFactory::saveToFile(makeNpcs(static_cast<size_t>(state.range(0)), 500.0), filename);
+    NPCFactory::LoadOptions options;
+    options.threads = static_cast<size_t>(state.range(1));
+    for (auto _ : state) {
+        NpcWorld world;
+        NPCFactory::loadIntoWorld(filename, world, options);
+        benchmark::DoNotOptimize(world.size());
+    }
+    remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FactoryLoadText)->Args({100000, 1})->Args({1000000, 1})->Args({1000000, 0})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_FactorySnapshotRoundTrip(benchmark::State& state) {
+    string filename = "bench_npcs.bin";
+    SilenceCout silence;
+    NpcWorld world;
+    world.addFrom(makeNpcs(static_cast<size_t>(state.range(0)), 500.0));
+    for (auto _ : state) {
+        NPCFactory::saveSnapshot(world, filename);
+        NpcWorld loaded;
+        NPCFactory::loadSnapshot(filename, loaded);
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FactorySnapshotRoundTrip)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Один тик всего движка (headless, без ограничения частоты). Время берётся из
+// статистики планировщика, так что запуск и остановка боевых потоков и
+// начальная расстановка NPC в замер не входят.
+static void BM_EngineTick(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    GameConfig config;
+    config.headless = true;
+    config.npcCount = count;
+    config.mapMaxX = mapSideFor(count);
+    config.mapMaxY = mapSideFor(count);
+    config.ticks = 1;
+    config.tickRate = 0.0;
+    config.hasSeed = true;
+    config.seed = BENCH_SEED;
+    config.threads = static_cast<size_t>(state.range(1));
+    config.logFile.clear();
+
+    array<double, TICK_PHASE_COUNT> phaseMs{};
+    SilenceCout silence;
+    for (auto _ : state) {
+        GameEngine engine(config);
+        engine.initializeGame();
+        engine.run();
+        auto stats = engine.getTickStats();
+        state.SetIterationTime(stats.lastTickMs / 1000.0);
+        for (size_t p = 0; p < TICK_PHASE_COUNT; p++) {
+            phaseMs[p] += stats.lastPhaseMs[p];
+        }
+    }
+    for (size_t p = 0; p < TICK_PHASE_COUNT; p++) {
+        state.counters[string(tickPhaseName(static_cast<TickPhase>(p))) + "_ms"] =
+            benchmark::Counter(phaseMs[p], benchmark::Counter::kAvgIterations);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EngineTick)
+    ->ArgsProduct({{1000, 10000, 100000}, {1, 4}})
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Асинхронная запись журнала: производители кладут готовые строки в
+// lock-free MPSC-кольцо, фоновый поток пишет их в один открытый дескриптор
+// и сбрасывает буфер по объёму или по таймеру. Без работы писатель спит на
+// условной переменной; производитель берёт мьютекс, только чтобы разбудить
+// уснувшего писателя. Строки длиннее RECORD_TEXT_SIZE обрезаются, получают
+// в конце TRUNCATED_MARK и учитываются в truncatedCount().
+class AsyncLogWriter {
+public:
+    static constexpr size_t RECORD_TEXT_SIZE = 240;
+    static constexpr std::string_view TRUNCATED_MARK = "...";
+
+    enum class OverflowPolicy {
+        DROP,
+        BLOCK
+    };
+
+    struct Options {
+        size_t capacity = 4096;
+        size_t flushBytes = 64 * 1024;
+        std::chrono::milliseconds flushInterval{200};
+        OverflowPolicy policy = OverflowPolicy::DROP;
+    };
+
+private:
+    struct Record {
+        std::atomic<size_t> sequence{0};
+        std::time_t time = 0;
+        uint16_t length = 0;
+        bool truncated = false;
+        std::array<char, RECORD_TEXT_SIZE> text{};
+    };
+
+    std::unique_ptr<Record[]> ring;
+    size_t mask;
+    Options options;
+    int fd;
+
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;
+    std::atomic<size_t> written{0};
+    std::atomic<size_t> dropped{0};
+    std::atomic<size_t> truncated{0};
+    std::atomic<size_t> flushes{0};
+    std::atomic<size_t> durablePos{0};
+    std::atomic<bool> flushWanted{false};
+    std::atomic<bool> stopFlag{false};
+    std::atomic<bool> writerIdle{false};
+    std::atomic<size_t> flushWaiters{0};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    std::condition_variable durableCv;
+    std::thread writer;
+
+    bool tryPush(std::time_t time, std::string_view line);
+    bool hasPending() const;
+    void wakeWriter();
+    void publishDurable();
+    bool popOne(std::string& out, std::time_t& lastTime, std::string& stamp);
+    void writerLoop();
+    void writeOut(std::string& buffer);
+
+public:
+    AsyncLogWriter(const std::string& path, const Options& options);
+    explicit AsyncLogWriter(const std::string& path) : AsyncLogWriter(path, Options()) {}
+    ~AsyncLogWriter();
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    bool isOpen() const { return fd >= 0; }
+
+    // Не блокируется на диске; false — запись отброшена (политика DROP).
+    bool push(std::string_view line);
+    // Дожидается, пока всё отправленное до вызова окажется в файле.
+    void flush();
+
+    size_t writtenCount() const { return written.load(); }
+    size_t droppedCount() const { return dropped.load(); }
+    size_t truncatedCount() const { return truncated.load(); }
+    size_t flushCount() const { return flushes.load(); }
+};
+
+#endif
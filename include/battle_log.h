@@ -0,0 +1,75 @@
+#ifndef BATTLE_LOG_H
+#define BATTLE_LOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+#include "observer.h"
+
+// Заголовок бинарного журнала боёв. Тик и id пишутся varint'ами с дельтами,
+// координаты — float32 (точность около 1e-7 от величины координаты). В версии 1
+// координаты квантовались в 16 бит на границы карты, т. е. с шагом
+// (max - min) / 65535; такие файлы читаются по-прежнему.
+struct BattleLogHeader {
+    static constexpr char MAGIC[4] = {'L', 'B', 'E', 'V'};
+    static constexpr uint16_t VERSION = 2;
+    static constexpr uint16_t QUANTIZED_VERSION = 1;
+
+    uint16_t version = VERSION;
+    uint64_t seed = 0;
+    double minX = 0.0;
+    double maxX = 100.0;
+    double minY = 0.0;
+    double maxY = 100.0;
+};
+
+std::string formatBattleEvent(const BattleEvent& event);
+std::string formatBattleEventCsv(const BattleEvent& event);
+const char* battleEventCsvHeader();
+
+// Append-only писатель для одного потока: движок копит события боевых потоков
+// в их собственных буферах и передаёт их сюда в конце тика, как и убийства.
+// append только копирует событие; кодирование и запись делает flush.
+class BattleEventWriter {
+private:
+    std::ofstream file;
+    BattleLogHeader header;
+    std::vector<BattleEvent> pending;
+    std::vector<uint8_t> encoded;
+    uint64_t prevTick = 0;
+    uint32_t prevDefender = 0;
+    size_t events = 0;
+    size_t bytes = 0;
+
+    void encode(const BattleEvent& event);
+
+public:
+    bool open(const std::string& filename, const BattleLogHeader& header);
+    bool isOpen() const { return file.is_open(); }
+    void append(const BattleEvent& event);
+    void append(std::span<const BattleEvent> batch);
+    void flush();
+    void close();
+
+    size_t eventCount() const { return events; }
+    size_t bytesWritten() const { return bytes; }
+};
+
+class BattleEventReader {
+private:
+    std::ifstream file;
+    BattleLogHeader logHeader;
+    uint64_t prevTick = 0;
+    uint32_t prevDefender = 0;
+
+    bool readVarint(uint64_t& value);
+
+public:
+    bool open(const std::string& filename);
+    const BattleLogHeader& header() const { return logHeader; }
+    bool next(BattleEvent& event);
+};
+
+#endif
@@ -6,49 +6,181 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <array>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <limits>
 #include "npc.h"
 #include "visitor.h"
 #include "observer.h"
+#include "battle_log.h"
+#include "spatial_grid.h"
+#include "npc_world.h"
+#include "rng.h"
+#include "tick_scheduler.h"
+#include "map_renderer.h"
+#include "parallel_runner.h"
+#include "profiler.h"
+#include "trace.h"
+
+struct GameConfig {
+    size_t npcCount = 50;
+    double mapMinX = 0.0;
+    double mapMaxX = 100.0;
+    double mapMinY = 0.0;
+    double mapMaxY = 100.0;
+    std::array<double, NPC_KIND_COUNT> speciesMix = {1.0, 1.0, 1.0};
+    uint64_t ticks = 600;
+    double tickRate = 20.0;
+    bool hasSeed = false;
+    uint64_t seed = 0;
+    size_t threads = 2;
+    // Потоки фаз движения и поиска боёв (0 — по числу ядер). На результат
+    // не влияют: у каждого NPC свой поток RNG, задачи сливаются по порядку кусков.
+    size_t phaseThreads = 0;
+    bool headless = false;
+    // ANSI: карта перерисовывается на месте, выводятся только изменения.
+    bool ansiMap = false;
+    // Вместо отдельных NPC показывать плотность по клеткам.
+    bool densityMap = false;
+    Viewport viewport;
+    std::string logFile = "game_log.txt";
+    std::string eventLogFile;
+    std::string loadFile;
+    // Контрольная точка пишется каждые checkpointEvery тиков (0 — только в конце run).
+    std::string checkpointFile;
+    uint64_t checkpointEvery = 0;
+    // Продолжение с контрольной точки; ticks тогда — номер последнего тика.
+    std::string resumeFile;
+    // Каждые profileEvery тиков в stderr уходит строка JSON с перцентилями
+    // фаз за прошедшее окно (0 — не печатать).
+    uint64_t profileEvery = 0;
+    // Chrome trace_event JSON по итогам run(); пишется, только если сборка
+    // с LABS_ENABLE_TRACING.
+    std::string traceFile;
+};
 
 class GameEngine {
 private:
-    static constexpr double MAP_MIN_X = 0.0;
-    static constexpr double MAP_MAX_X = 100.0;
-    static constexpr double MAP_MIN_Y = 0.0;
-    static constexpr double MAP_MAX_Y = 100.0;
-    static constexpr int GAME_DURATION = 30;
-    static constexpr int NPC_COUNT = 50;
     static constexpr int DISPLAY_INTERVAL = 1;
+    static constexpr size_t BATTLE_BATCH_SIZE = 64;
     
+    GameConfig config;
+    uint64_t seed;
     std::vector<std::shared_ptr<NPC>> npcs;
+    NpcWorld world;
+    std::unique_ptr<SpatialGrid> spatialGrid;
+    
+    static constexpr size_t MIN_PHASE_CHUNK = 4096;
+    static constexpr size_t CHUNKS_PER_THREAD = 4;
+    static constexpr uint64_t NO_CHECKPOINT = std::numeric_limits<uint64_t>::max();
+    
+    // Буферы одного куска фазы поиска боёв; живут между тиками.
+    struct DetectChunk {
+        std::vector<double> candidateX;
+        std::vector<double> candidateY;
+        std::vector<uint32_t> candidateIds;
+        std::vector<uint32_t> hitSlots;
+        std::vector<BattleTask> tasks;
+    };
+    
+    std::vector<double> moveDirX;
+    std::vector<double> moveDirY;
+    std::vector<double> moveStep;
+    std::vector<DetectChunk> detectChunks;
+    ParallelRunner phaseRunner;
     BattleQueue battleQueue;
     BattleLogger battleLogger;
+    std::shared_ptr<FileLogger> fileLogger;
+    BattleEventWriter eventLog;
+    BattleStatsObserver battleStats;
+    size_t battleWorkerCount;
+    std::vector<std::vector<BattleEvent>> lethalHits;
+    // Бои без убийства для журнала событий, тоже по потокам; сливаются в commitKills.
+    std::vector<std::vector<BattleEvent>> loggedBattles;
+    std::vector<BattleEvent> pendingKills;
     
-    std::thread movementThread;
-    std::thread battleThread;
-    std::thread displayThread;
+    TickScheduler scheduler;
+    // Слот 0 — поток тиков, слот 1 + workerId — боевые потоки.
+    TickProfiler profiler;
+    TickProfiler::Snapshot lastProfile;
+    TickProfiler::Clock::time_point tickStart;
+    MapRenderer renderer;
+    std::vector<std::thread> battleThreads;
     
     std::atomic<bool> gameRunning;
     std::atomic<int> elapsedTime;
+    double wallTimeMs = 0.0;
+    // Время считается по тикам и tickRate, а без ограничения частоты — по часам.
+    std::chrono::steady_clock::time_point runStarted;
+    double nextMapSeconds = 0.0;
     
-    mutable std::mutex coutMutex;
+    std::mutex checkpointMutex;
+    std::string requestedCheckpoint;
+    // Тик последней периодической точки: если run() закончился на нём,
+    // файл в конце не переписывается.
+    uint64_t periodicCheckpointTick = NO_CHECKPOINT;
+    
+    // Захваты блокировок за последний run() (нули без LABS_LOCK_STATS).
+    lockstats::Snapshot lockBaseline{};
+    lockstats::Snapshot lockUsage{};
+    
+    mutable ConsoleMutex coutMutex;
     
 public:
-    GameEngine();
+    explicit GameEngine(const GameConfig& config = GameConfig());
     ~GameEngine();
     
     void initializeGame();
     void run();
     void stop();
     
+    const GameConfig& getConfig() const { return config; }
+    size_t getKillCount() const { return battleStats.killCount(); }
+    const BattleStatsObserver& getBattleStats() const { return battleStats; }
+    // Подключение наблюдателей на лету, в том числе во время run().
+    BattleSubject::ObserverId attachObserver(std::shared_ptr<BattleObserver> observer) { return battleLogger.attach(std::move(observer)); }
+    bool detachObserver(BattleSubject::ObserverId id) { return battleLogger.detach(id); }
+    void setSeed(uint64_t newSeed) { seed = newSeed; }
+    uint64_t getSeed() const { return seed; }
+    uint64_t getTick() const { return scheduler.currentTick(); }
+    void setTickRate(double ticksPerSecond) { scheduler.setTickRate(ticksPerSecond); }
+    TickScheduler::Stats getTickStats() const { return scheduler.getStats(); }
+    TickProfiler::Stats getProfile() const { return profiler.stats(); }
+    const lockstats::Snapshot& getLockStats() const { return lockUsage; }
+    const NpcWorld& getWorld() const { return world; }
+    size_t getAliveCount() const { return world.aliveCount(); }
+    std::array<size_t, NPC_KIND_COUNT> getAliveByKind() const;
+    
+    // Только между тиками: до/после run() или из потока тиков.
+    bool saveCheckpoint(const std::string& filename) const;
+    // Из любого потока: точка будет записана на ближайшей границе тика.
+    void requestCheckpoint(const std::string& filename);
+    
 private:
-    void movementWorker();
-    void battleWorker();
-    void displayWorker();
-    void processBattle(const BattleTask& task);
-    void printMap() const;
+    void setupPhases();
+    void movementPhase(uint64_t tick);
+    void detectionPhase(uint64_t tick);
+    size_t phaseChunkCount(size_t count) const;
+    void detectChunk(DetectChunk& chunk, size_t begin, size_t end, uint64_t tick);
+    void resolvePhase(uint64_t tick);
+    void observePhase(uint64_t tick);
+    void battleWorker(size_t workerId);
+    void processBattle(const BattleTask& task, size_t workerId);
+    void commitKills();
+    void printMap();
     void printSurvivors() const;
+    void printSummary() const;
+    void dumpProfile(uint64_t tick);
     void createRandomNPCs();
+    void loadNPCs();
+    bool restoreCheckpoint(const std::string& filename);
+    // Внутри фазы тика currentTick() ещё предыдущий, поэтому номер передаётся явно.
+    bool saveCheckpoint(const std::string& filename, uint64_t tick) const;
+    void writePendingCheckpoints(uint64_t tick);
+    void buildObjects();
+    void buildSpatialIndex();
     template<typename T>
     void safePrint(const T& message) const;
 };
@@ -0,0 +1,103 @@
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+enum class LockClass {
+    NPC,
+    QUEUE_SHARD,
+    QUEUE_WAIT,
+    CONSOLE,
+    COUNT
+};
+
+constexpr size_t LOCK_CLASS_COUNT = static_cast<size_t>(LockClass::COUNT);
+
+const char* lockClassName(LockClass lockClass);
+
+// Счётчики захватов по классам блокировок. Собираются, только если задан
+// LABS_LOCK_STATS (CMake-опция LABS_LOCK_STATS): тогда ProfiledMutex — это
+// InstrumentedMutex, иначе обычный std::mutex без накладных расходов.
+namespace lockstats {
+
+#ifdef LABS_LOCK_STATS
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+struct alignas(64) Counters {
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> waitNs{0};
+};
+
+inline std::array<Counters, LOCK_CLASS_COUNT> counters;
+
+struct ClassStats {
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t waitNs = 0;
+};
+
+using Snapshot = std::array<ClassStats, LOCK_CLASS_COUNT>;
+
+Snapshot snapshot();
+// Разность двух снимков — счётчики за интервал.
+Snapshot since(const Snapshot& now, const Snapshot& earlier);
+// {"npc":{"acquired":..,"contended":..,"wait_ms":..},...}
+std::string toJson(const Snapshot& stats);
+std::string toText(const Snapshot& stats);
+
+}
+
+// Захват сначала пробуется без ожидания; ожидание меряется только для
+// занятой блокировки, так что неконкурентный путь стоит один try_lock.
+template<LockClass CLASS>
+class InstrumentedMutex {
+private:
+    std::mutex mtx;
+
+    static lockstats::Counters& stats() {
+        return lockstats::counters[static_cast<size_t>(CLASS)];
+    }
+
+public:
+    void lock() {
+        if (!mtx.try_lock()) {
+            auto start = std::chrono::steady_clock::now();
+            mtx.lock();
+            auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            stats().contended.fetch_add(1, std::memory_order_relaxed);
+            stats().waitNs.fetch_add(static_cast<uint64_t>(waited.count()), std::memory_order_relaxed);
+        }
+        stats().acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool try_lock() {
+        if (!mtx.try_lock()) return false;
+        stats().acquisitions.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void unlock() {
+        mtx.unlock();
+    }
+};
+
+template<LockClass CLASS>
+using ProfiledMutex = std::conditional_t<lockstats::ENABLED, InstrumentedMutex<CLASS>, std::mutex>;
+
+// condition_variable работает только с std::mutex.
+template<typename Mutex>
+using ConditionFor = std::conditional_t<std::is_same_v<Mutex, std::mutex>,
+                                        std::condition_variable, std::condition_variable_any>;
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef MAP_RENDERER_H
+#define MAP_RENDERER_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include "npc_world.h"
+#include "parallel_runner.h"
+
+// Окно на карту: размер в символах, центр в мировых координатах
+// (NaN — центр карты) и увеличение (1 — вся карта).
+struct Viewport {
+    size_t width = 50;
+    size_t height = 20;
+    double centerX = std::numeric_limits<double>::quiet_NaN();
+    double centerY = std::numeric_limits<double>::quiet_NaN();
+    double zoom = 1.0;
+};
+
+// Рисует карту в задний кадр и сравнивает его с передним. В режиме TEXT
+// каждый кадр выводится целиком; в режиме ANSI — только изменившиеся клетки
+// и строки состояния, с перемещением курсора escape-последовательностями.
+// Стиль DENSITY вместо отдельных NPC показывает, сколько их в клетке
+// (логарифмическая шкала), а в ANSI красит клетку цветом преобладающего вида.
+class MapRenderer {
+public:
+    enum class Mode {
+        TEXT,
+        ANSI
+    };
+    
+    enum class Style {
+        SYMBOLS,
+        DENSITY
+    };
+    
+    using Bin = std::array<uint32_t, NPC_KIND_COUNT>;
+
+private:
+    Mode mode;
+    Style style = Style::SYMBOLS;
+    ParallelRunner* runner = nullptr;
+    Viewport viewport;
+    double viewMinX = 0.0;
+    double viewMinY = 0.0;
+    double viewWidth = 1.0;
+    double viewHeight = 1.0;
+    std::vector<char> frontFrame;
+    std::vector<char> backFrame;
+    std::vector<uint8_t> frontColors;
+    std::vector<uint8_t> backColors;
+    std::vector<Bin> bins;
+    // Корзины кусков и суммы по клеткам живут между кадрами.
+    std::vector<std::vector<Bin>> partialBins;
+    std::vector<uint32_t> totals;
+    uint32_t peak = 0;
+    std::vector<std::string> frontLines;
+    bool needFullRedraw = true;
+    size_t lastChanged = 0;
+
+    std::string presentText(const std::string& header, const std::vector<std::string>& footer);
+    std::string presentAnsi(const std::string& header, const std::vector<std::string>& footer);
+    bool cellPosition(double x, double y, size_t& cell) const;
+    void rasterizeSymbols(const NpcWorld& world, const NpcWorld::Positions& positions);
+    void rasterizeDensity(const NpcWorld& world, const NpcWorld::Positions& positions);
+    void appendRow(std::string& out, size_t row, size_t begin, size_t end) const;
+
+public:
+    MapRenderer(Mode mode, const Viewport& viewport);
+
+    void setBounds(double minX, double maxX, double minY, double maxY);
+    Mode getMode() const { return mode; }
+    void setStyle(Style newStyle) { style = newStyle; needFullRedraw = true; }
+    Style getStyle() const { return style; }
+    // Пул для подсчёта плотности (обычно пул фаз движка); без него и для
+    // маленьких миров считается в одном потоке.
+    void setRunner(ParallelRunner* pool) { runner = pool; }
+    const Viewport& getViewport() const { return viewport; }
+
+    // positions — снимок координат (front-буфер мира), читается без блокировок.
+    void rasterize(const NpcWorld& world, const NpcWorld::Positions& positions);
+    std::string present(const std::string& header, const std::vector<std::string>& footer);
+    void invalidate() { needFullRedraw = true; }
+
+    size_t changedCells() const { return lastChanged; }
+    char cellAt(size_t col, size_t row) const { return frontFrame[row * viewport.width + col]; }
+    const Bin& binAt(size_t col, size_t row) const { return bins[row * viewport.width + col]; }
+    uint32_t peakDensity() const { return peak; }
+};
+
+#endif
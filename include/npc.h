@@ -3,57 +3,94 @@
 
 #include <string>
 #include <memory>
-#include <random>
 #include <mutex>
+#include <array>
+#include <cstdint>
+#include "rng.h"
+#include "lock_stats.h"
 
 class NPCVisitor;
 
+enum class NPCKind : uint8_t {
+    SQUIRREL,
+    WEREWOLF,
+    DRUID,
+    COUNT
+};
+
+constexpr size_t NPC_KIND_COUNT = static_cast<size_t>(NPCKind::COUNT);
+
+constexpr uint32_t kindBit(NPCKind kind) {
+    return 1u << static_cast<uint32_t>(kind);
+}
+
+using NpcMutex = ProfiledMutex<LockClass::NPC>;
+
 class NPC {
 protected:
+    const NPCKind kind;
     std::string name;
     double x;
     double y;
     bool alive;
-    mutable std::mutex mtx;
-    static std::mt19937 rng;
-    static std::uniform_int_distribution<int> dice;
+    mutable NpcMutex mtx;
     
 public:
-    NPC(const std::string& name, double x, double y);
+    // Согласованный срез полей под одним захватом мьютекса
+    struct State {
+        std::string name;
+        double x;
+        double y;
+        bool alive;
+    };
+    
+    NPC(NPCKind kind, const std::string& name, double x, double y);
     virtual ~NPC() = default;
     std::string getName() const;
     std::string getType() const;
+    NPCKind getKind() const { return kind; }
     double getX() const;
     double getY() const;
     bool isAlive() const;
+    State getState() const;
     void setPosition(double newX, double newY);
     void setAlive(bool status);
     
     virtual void accept(NPCVisitor& visitor) = 0;
-    virtual bool canAttack(const NPC* other) const = 0;
+    bool canAttack(const NPC* other) const;
     virtual double getMoveDistance() const = 0;
     virtual double getAttackDistance() const = 0;
     
     void move(double minX, double maxX, double minY, double maxY);
     
     double calculateDistance(const NPC* other) const;
+    double calculateDistanceSquared(const NPC* other) const;
     
     static bool isValidCoordinates(double x, double y);
     
     static int rollDice();
+    static int rollDice(RngStream& rng);
     
     virtual bool tryAttack(NPC* other) = 0;
     
     virtual char getMapSymbol() const = 0;
     
-    std::unique_lock<std::mutex> getLock() const;
+    std::unique_lock<NpcMutex> getLock() const;
 };
 
+// Новый вид задаёт KIND, PREY (маску видов-жертв), параметры движения/атаки
+// и добавляется в AllSpecies — матрица атак и таблица свойств строятся сами.
 class Squirrel : public NPC {
 public:
+    static constexpr NPCKind KIND = NPCKind::SQUIRREL;
+    static constexpr const char* NAME = "Squirrel";
+    static constexpr uint32_t PREY = kindBit(NPCKind::WEREWOLF) | kindBit(NPCKind::DRUID);
+    static constexpr double MOVE_DISTANCE = 5.0;
+    static constexpr double ATTACK_DISTANCE = 5.0;
+    static constexpr char SYMBOL = 'S';
+    
     Squirrel(const std::string& name, double x, double y);
     void accept(NPCVisitor& visitor) override;
-    bool canAttack(const NPC* other) const override;
     double getMoveDistance() const override;
     double getAttackDistance() const override;
     bool tryAttack(NPC* other) override;
@@ -62,9 +99,15 @@ public:
 
 class Werewolf : public NPC {
 public:
+    static constexpr NPCKind KIND = NPCKind::WEREWOLF;
+    static constexpr const char* NAME = "Werewolf";
+    static constexpr uint32_t PREY = kindBit(NPCKind::DRUID);
+    static constexpr double MOVE_DISTANCE = 40.0;
+    static constexpr double ATTACK_DISTANCE = 5.0;
+    static constexpr char SYMBOL = 'W';
+    
     Werewolf(const std::string& name, double x, double y);
     void accept(NPCVisitor& visitor) override;
-    bool canAttack(const NPC* other) const override;
     double getMoveDistance() const override;
     double getAttackDistance() const override;
     bool tryAttack(NPC* other) override;
@@ -73,13 +116,76 @@ public:
 
 class Druid : public NPC {
 public:
+    static constexpr NPCKind KIND = NPCKind::DRUID;
+    static constexpr const char* NAME = "Druid";
+    static constexpr uint32_t PREY = 0;
+    static constexpr double MOVE_DISTANCE = 10.0;
+    static constexpr double ATTACK_DISTANCE = 10.0;
+    static constexpr char SYMBOL = 'D';
+    
     Druid(const std::string& name, double x, double y);
     void accept(NPCVisitor& visitor) override;
-    bool canAttack(const NPC* other) const override;
     double getMoveDistance() const override;
     double getAttackDistance() const override;
     bool tryAttack(NPC* other) override;
     char getMapSymbol() const override;
 };
 
+template<typename... Species>
+struct SpeciesList {};
+
+using AllSpecies = SpeciesList<Squirrel, Werewolf, Druid>;
+
+struct SpeciesTraits {
+    const char* name = "Unknown";
+    double moveDistance = 0.0;
+    double attackDistance = 0.0;
+    char mapSymbol = '?';
+    uint32_t prey = 0;
+};
+
+using AttackMatrix = std::array<std::array<bool, NPC_KIND_COUNT>, NPC_KIND_COUNT>;
+using SpeciesTable = std::array<SpeciesTraits, NPC_KIND_COUNT>;
+
+template<typename... Species>
+constexpr SpeciesTable makeSpeciesTable(SpeciesList<Species...>) {
+    SpeciesTable table{};
+    ((table[static_cast<size_t>(Species::KIND)] =
+        SpeciesTraits{Species::NAME, Species::MOVE_DISTANCE, Species::ATTACK_DISTANCE, Species::SYMBOL, Species::PREY}), ...);
+    return table;
+}
+
+constexpr AttackMatrix makeAttackMatrix(const SpeciesTable& table) {
+    AttackMatrix matrix{};
+    for (size_t a = 0; a < NPC_KIND_COUNT; a++) {
+        for (size_t d = 0; d < NPC_KIND_COUNT; d++) {
+            matrix[a][d] = (table[a].prey & (1u << d)) != 0;
+        }
+    }
+    return matrix;
+}
+
+inline constexpr SpeciesTable SPECIES = makeSpeciesTable(AllSpecies{});
+inline constexpr AttackMatrix ATTACK_MATRIX = makeAttackMatrix(SPECIES);
+
+constexpr const SpeciesTraits& speciesTraits(NPCKind kind) {
+    return SPECIES[static_cast<size_t>(kind)];
+}
+
+constexpr bool kindCanAttack(NPCKind attacker, NPCKind defender) {
+    return ATTACK_MATRIX[static_cast<size_t>(attacker)][static_cast<size_t>(defender)];
+}
+
+constexpr double maxSpeciesAttackDistance() {
+    double result = 0.0;
+    for (const auto& traits : SPECIES) {
+        if (traits.attackDistance > result) result = traits.attackDistance;
+    }
+    return result;
+}
+
+static_assert(kindCanAttack(NPCKind::SQUIRREL, NPCKind::WEREWOLF));
+static_assert(!kindCanAttack(NPCKind::WEREWOLF, NPCKind::SQUIRREL));
+static_assert(!kindCanAttack(NPCKind::DRUID, NPCKind::SQUIRREL));
+
 #endif
\ No newline at end of file
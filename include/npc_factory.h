@@ -5,17 +5,41 @@
 #include <string>
 #include <vector>
 #include "npc.h"
+#include "npc_world.h"
 
 class NPCFactory{
 public:
-    enum class NPCType{
-        SQUIRREL,
-        WEREWOLF,
-        DRUID
+    using NPCType = NPCKind;
+    
+    struct LoadOptions {
+        double minX = 0.0;
+        double maxX = 500.0;
+        double minY = 0.0;
+        double maxY = 500.0;
+        // 0 — по числу ядер; маленькие файлы всё равно разбираются в один поток.
+        size_t threads = 0;
     };
+    
+    struct LoadReport {
+        static constexpr size_t MAX_REPORTED_LINES = 10;
+        size_t loaded = 0;
+        size_t badLines = 0;
+        std::vector<size_t> badLineNumbers;
+    };
+    
     static std::shared_ptr<NPC> createNPC(NPCType type, const std::string& name, double x, double y);
+    static std::shared_ptr<NPC> construct(NPCType type, const std::string& name, double x, double y);
     static bool saveToFile(const std::vector<std::shared_ptr<NPC>>& npcs, const std::string& filename);
     static std::vector<std::shared_ptr<NPC>> loadFromFile(const std::string& filename);
+    // Отображает файл в память и разбирает его from_chars'ом, по кускам в
+    // нескольких потоках; плохие строки не печатаются, а попадают в отчёт.
+    static bool loadIntoWorld(const std::string& filename, NpcWorld& world,
+                              const LoadOptions& options, LoadReport* report = nullptr);
+    // Бинарный снимок (см. snapshot.h): сохраняет и мёртвых, проверяет CRC.
+    static bool saveSnapshot(const NpcWorld& world, const std::string& filename);
+    static bool saveSnapshot(const std::vector<std::shared_ptr<NPC>>& npcs, const std::string& filename);
+    static bool loadSnapshot(const std::string& filename, NpcWorld& world);
+    static std::vector<std::shared_ptr<NPC>> loadSnapshot(const std::string& filename);
     static NPCType stringToType(const std::string& typeStr);
     static std::string typeToString(NPCType type);
 };
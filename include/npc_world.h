@@ -0,0 +1,78 @@
+#ifndef NPC_WORLD_H
+#define NPC_WORLD_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <array>
+#include <span>
+#include <string_view>
+#include "npc.h"
+
+// Хранилище NPC в виде структуры массивов. Координаты лежат в двух буферах:
+// фаза движения читает front и пишет back, после чего буферы меняются местами.
+class NpcWorld {
+public:
+    using Kind = NPCKind;
+
+    struct Positions {
+        std::vector<double> x;
+        std::vector<double> y;
+    };
+
+private:
+    Positions buffers[2];
+    int frontIndex = 0;
+    mutable std::mutex swapMutex;
+    mutable std::vector<uint8_t> alive;
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> nameIndex;
+    std::vector<std::string> names;
+    std::array<std::atomic<size_t>, NPC_KIND_COUNT> aliveByKind{};
+
+public:
+    void reserve(size_t count);
+    size_t add(Kind kind, const std::string& name, double x, double y);
+    void addFrom(const std::vector<std::shared_ptr<NPC>>& npcs);
+    // Пакетное добавление живых NPC из параллельных массивов одной длины.
+    void append(std::span<const Kind> kinds, std::span<const double> xs, std::span<const double> ys,
+                std::span<const std::string_view> names);
+    void syncTo(const std::vector<std::shared_ptr<NPC>>& npcs) const;
+    void clear();
+
+    size_t size() const { return kinds.size(); }
+
+    // front/back/swapBuffers вызывает только поток, владеющий движением.
+    const Positions& front() const { return buffers[frontIndex]; }
+    Positions& back() { return buffers[frontIndex ^ 1]; }
+    void swapBuffers();
+
+    // Чтение front из других потоков: обмен буферов дождётся конца чтения.
+    template<typename Fn>
+    auto readFront(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(swapMutex);
+        return fn(static_cast<const Positions&>(buffers[frontIndex]));
+    }
+
+    bool isAlive(size_t i) const {
+        return std::atomic_ref<uint8_t>(alive[i]).load(std::memory_order_acquire) != 0;
+    }
+    bool kill(size_t i);
+
+    // Счётчики живых ведутся при add/kill, чтение — O(1) из любого потока.
+    size_t aliveCount(Kind kind) const { return aliveByKind[static_cast<size_t>(kind)].load(std::memory_order_relaxed); }
+    size_t aliveCount() const;
+
+    Kind kind(size_t i) const { return static_cast<Kind>(kinds[i]); }
+    const std::string& name(size_t i) const { return names[nameIndex[i]]; }
+
+    const SpeciesTraits& traitsAt(size_t i) const { return SPECIES[kinds[i]]; }
+    bool canAttack(size_t attacker, size_t defender) const { return ATTACK_MATRIX[kinds[attacker]][kinds[defender]]; }
+    static bool canAttackAnything(Kind kind) { return speciesTraits(kind).prey != 0; }
+    static constexpr double maxAttackDistance() { return maxSpeciesAttackDistance(); }
+};
+
+#endif
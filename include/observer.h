@@ -4,39 +4,163 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <string_view>
+#include "npc.h"
+#include "async_log.h"
 
+// Исход одного боя. Имена — view на строки мира, живущие всё время игры.
+struct BattleEvent {
+    uint64_t tick = 0;
+    uint32_t attackerId = 0;
+    uint32_t defenderId = 0;
+    NPCKind attackerKind = NPCKind::SQUIRREL;
+    NPCKind defenderKind = NPCKind::SQUIRREL;
+    uint8_t attackRoll = 0;
+    uint8_t defenseRoll = 0;
+    bool killed = false;
+    // Бросок выигран, но жертву в этом тике уже убил другой нападающий.
+    bool targetAlreadyDead = false;
+    double attackerX = 0.0;
+    double attackerY = 0.0;
+    double defenderX = 0.0;
+    double defenderY = 0.0;
+    std::string_view attackerName;
+    std::string_view defenderName;
+};
+
+// Пишет «A (вид) killed B (вид)» в out без выделений памяти; возвращает длину.
+size_t describeBattle(const BattleEvent& event, char* out, size_t capacity);
+std::string describeBattle(const BattleEvent& event);
+
+class BattleObserver;
+
+// Список наблюдателей по схеме copy-on-write: attach/detach собирают новый
+// вектор под writeMutex, публикуют его и увеличивают version. notify держит
+// в потоке закэшированный снимок и перечитывает его, только если version
+// изменилась, — на горячем пути одна атомарная загрузка, без блокировок и
+// счётчиков ссылок. Отключённый наблюдатель может получить ещё одно событие
+// из старого снимка; владеющий снимок держит его живым, пока поток не
+// перечитает список.
 class BattleSubject{
+public:
+    using ObserverId = uint64_t;
+    
 private:
-    std::vector<class BattleObserver*> observers;
+    struct Entry {
+        ObserverId id;
+        std::shared_ptr<BattleObserver> observer;
+    };
+    using ObserverList = std::vector<Entry>;
+    
+    // Снимок последнего оповещавшего субъекта в этом потоке.
+    struct ThreadCache {
+        uint64_t subjectId = 0;
+        uint64_t version = 0;
+        std::shared_ptr<const ObserverList> list;
+        int depth = 0;
+    };
+    
+    static inline std::atomic<uint64_t> nextSubjectId{1};
+    
+    const uint64_t subjectId = nextSubjectId.fetch_add(1, std::memory_order_relaxed);
+    std::atomic<std::shared_ptr<const ObserverList>> observers{std::make_shared<const ObserverList>()};
+    std::atomic<uint64_t> version{0};
+    std::mutex writeMutex;
+    ObserverId nextId = 1;
+    
+    static ThreadCache& threadCache();
+    ObserverId add(std::shared_ptr<BattleObserver> observer);
+    void publish(std::shared_ptr<const ObserverList> updated);
+    template<typename Fn>
+    void forEachObserver(Fn&& fn);
+    
 public:
-    void attach(BattleObserver * observer);
-    void detach(BattleObserver * observer);
+    // Владеющая регистрация.
+    ObserverId attach(std::shared_ptr<BattleObserver> observer);
+    // Невладеющая: объект должен пережить подписку.
+    ObserverId attach(BattleObserver * observer);
+    bool detach(ObserverId id);
+    bool detach(BattleObserver * observer);
+    size_t observerCount() const;
     void notify(const std::string &event);
+    void notify(const BattleEvent &event);
 };
 
+// onBattle получает событие как есть; по умолчанию убийства форматируются
+// в текст и уходят в update, так что строку строят только текстовые логгеры.
 class BattleObserver {
 public:
     virtual ~BattleObserver() = default;
-    virtual void update(const std::string &event) = 0;
+    virtual void update(const std::string &) {}
+    virtual void onBattle(const BattleEvent &event);
 };
 
+// Общая блокировка консоли: под ней движок печатает карту и сообщения.
+using ConsoleMutex = ProfiledMutex<LockClass::CONSOLE>;
+
+// Каждая строка выводится одной записью под consoleLock (если задан), чтобы
+// не попасть внутрь кадра карты.
 class ConsoleLogger : public BattleObserver {
+private:
+    ConsoleMutex *consoleLock;
+    
+    void write(const char *text, size_t length);
+    
 public:
+    explicit ConsoleLogger(ConsoleMutex *consoleLock = nullptr) : consoleLock(consoleLock) {}
     void update(const std::string &event) override;
+    void onBattle(const BattleEvent &event) override;
 };
 
+// Пишет в файл через AsyncLogWriter: update только кладёт строку в кольцо.
 class FileLogger : public BattleObserver {
 private:
     std::string filename;
+    std::unique_ptr<AsyncLogWriter> writer;
     
 public:
     FileLogger(const std::string &filename = "log.txt");
+    FileLogger(const std::string &filename, const AsyncLogWriter::Options &options);
     void update(const std::string &event) override;
+    void onBattle(const BattleEvent &event) override;
+    void flush();
+    size_t droppedCount() const;
+};
+
+// Только счётчики: несколько relaxed-инкрементов на бой, без форматирования.
+class BattleStatsObserver : public BattleObserver {
+public:
+    struct Counters {
+        size_t battles = 0;
+        size_t kills = 0;
+        std::array<size_t, NPC_KIND_COUNT> killsBy{};
+        std::array<size_t, NPC_KIND_COUNT> lossesOf{};
+    };
+    
+private:
+    std::atomic<size_t> battles{0};
+    std::atomic<size_t> kills{0};
+    std::array<std::atomic<size_t>, NPC_KIND_COUNT> killsBy{};
+    std::array<std::atomic<size_t>, NPC_KIND_COUNT> lossesOf{};
+    
+public:
+    void onBattle(const BattleEvent &event) override;
+    size_t battleCount() const { return battles.load(std::memory_order_relaxed); }
+    size_t killCount() const { return kills.load(std::memory_order_relaxed); }
+    size_t killsByKind(NPCKind kind) const;
+    size_t lossesOfKind(NPCKind kind) const;
+    Counters counters() const;
+    void restore(const Counters& counters);
 };
 
 class BattleLogger : public BattleSubject {
 public:
     void logBattleEvent(const std::string &event);
+    void logBattleEvent(const BattleEvent &event);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef PARALLEL_RUNNER_H
+#define PARALLEL_RUNNER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Постоянный пул для data-parallel фаз тика. run раздаёт номера кусков
+// через атомарный счётчик; вызывающий поток тоже берёт куски и возвращается,
+// когда каждый разбуженный поток отметился в этом запуске. Будятся только
+// min(chunks - 1, рабочих) потоков, а создаются они при первой надобности.
+class ParallelRunner {
+public:
+    using ChunkFn = std::function<void(size_t chunk)>;
+
+private:
+    struct Worker {
+        std::thread thread;
+        std::condition_variable wakeCv;
+        uint64_t assigned = 0;  // поколение, в котором поток участвует; под mtx
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    size_t maxWorkers = 0;
+    std::mutex mtx;
+    std::condition_variable doneCv;
+    const ChunkFn* job = nullptr;
+    size_t chunkCount = 0;
+    std::atomic<size_t> nextChunk{0};
+    uint64_t generation = 0;
+    size_t finishedWorkers = 0;
+    bool stopping = false;
+
+    void workerLoop(Worker& self);
+    void runChunks(const ChunkFn& fn, size_t chunks);
+
+public:
+    // threads — всего потоков вместе с вызывающим; 0 — по числу ядер.
+    explicit ParallelRunner(size_t threads = 1);
+    ~ParallelRunner();
+
+    ParallelRunner(const ParallelRunner&) = delete;
+    ParallelRunner& operator=(const ParallelRunner&) = delete;
+
+    size_t threadCount() const { return maxWorkers + 1; }
+    // Сколько рабочих потоков уже создано (не больше threadCount() - 1)
+    size_t startedWorkers() const { return workers.size(); }
+    void run(size_t chunks, const ChunkFn& fn);
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class ProfilePoint {
+    MOVE,
+    DETECT,
+    RESOLVE,
+    OBSERVE,
+    TICK,
+    BATTLE,
+    QUEUE_WAIT,
+    RENDER,
+    COUNT
+};
+
+constexpr size_t PROFILE_POINT_COUNT = static_cast<size_t>(ProfilePoint::COUNT);
+
+const char* profilePointName(ProfilePoint point);
+
+// Гистограмма задержек в наносекундах в духе HDR: корзины по степеням двойки,
+// каждая поделена на SUB_BUCKETS равных частей, так что погрешность значения
+// не больше 1/SUB_BUCKETS. Пишет один поток, читать можно из любого.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Слитые счётчики нескольких гистограмм; разность двух снимков — окно.
+    struct Counts {
+        std::vector<uint64_t> buckets = std::vector<uint64_t>(BUCKET_COUNT);
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+
+        Counts since(const Counts& earlier) const;
+    };
+
+    struct Summary {
+        uint64_t count = 0;
+        double meanUs = 0.0;
+        double p50Us = 0.0;
+        double p99Us = 0.0;
+        double maxUs = 0.0;
+    };
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+
+public:
+    static size_t bucketIndex(uint64_t ns);
+    // Наибольшее значение, попадающее в корзину.
+    static uint64_t bucketValue(size_t index);
+    static uint64_t percentile(const Counts& counts, double quantile);
+    static Summary summarize(const Counts& counts);
+
+    void record(uint64_t ns);
+    void addTo(Counts& counts) const;
+};
+
+// Гистограммы по точкам замера, по одному набору на поток: 0 — поток тиков,
+// остальные слоты движок раздаёт боевым потокам.
+class TickProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Snapshot = std::array<LatencyHistogram::Counts, PROFILE_POINT_COUNT>;
+    using Stats = std::array<LatencyHistogram::Summary, PROFILE_POINT_COUNT>;
+
+private:
+    using ThreadHistograms = std::array<LatencyHistogram, PROFILE_POINT_COUNT>;
+    std::vector<std::unique_ptr<ThreadHistograms>> threads;
+
+public:
+    explicit TickProfiler(size_t threadCount);
+
+    LatencyHistogram& histogram(size_t thread, ProfilePoint point) {
+        return (*threads[thread])[static_cast<size_t>(point)];
+    }
+    void record(size_t thread, ProfilePoint point, Clock::time_point start) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        histogram(thread, point).record(static_cast<uint64_t>(ns));
+    }
+
+    Snapshot snapshot() const;
+    static Stats summarize(const Snapshot& snapshot);
+    Stats stats() const { return summarize(snapshot()); }
+    // {"move":{"n":..,"mean_us":..,"p50_us":..,"p99_us":..,"max_us":..},...}
+    static std::string toJson(const Stats& stats);
+};
+
+class ScopedTimer {
+private:
+    LatencyHistogram& histogram;
+    TickProfiler::Clock::time_point start;
+
+public:
+    explicit ScopedTimer(LatencyHistogram& histogram)
+        : histogram(histogram), start(TickProfiler::Clock::now()) {}
+    ~ScopedTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TickProfiler::Clock::now() - start).count();
+        histogram.record(static_cast<uint64_t>(ns));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+// Счётчиковый генератор Philox4x32-10: значение блока зависит только от
+// (seed, stream, counter), поэтому потоки независимы и воспроизводимы при
+// любом порядке исполнения.
+class Philox4x32 {
+public:
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static Counter generate(Counter counter, Key key);
+};
+
+enum class RngDomain : uint8_t {
+    SPAWN,
+    MOVEMENT,
+    BATTLE,
+    THREAD
+};
+
+class RngStream {
+public:
+    using result_type = uint32_t;
+
+private:
+    Philox4x32::Key key;
+    Philox4x32::Counter counter;
+    Philox4x32::Counter block;
+    unsigned index;
+
+public:
+    RngStream(uint64_t seed, uint64_t streamId, uint64_t position = 0);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()();
+    double uniform();
+    double uniform(double lo, double hi);
+    uint32_t below(uint32_t bound);
+    int rollDice();
+
+    uint64_t position() const;
+};
+
+class RngService {
+private:
+    static std::atomic<uint64_t> seedValue;
+    static std::atomic<uint64_t> nextThreadStream;
+
+public:
+    static void setGlobalSeed(uint64_t seed);
+    static uint64_t globalSeed();
+    static uint64_t randomSeed();
+
+    static uint64_t streamId(RngDomain domain, uint64_t id);
+    static RngStream stream(uint64_t seed, RngDomain domain, uint64_t id, uint64_t position = 0);
+
+    // Поток, принадлежащий текущему потоку исполнения, от глобального seed.
+    static RngStream& threadStream();
+};
+
+#endif
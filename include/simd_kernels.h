@@ -0,0 +1,47 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Пакетные ядра над координатами NpcWorld. Реализация выбирается один раз
+// по возможностям процессора: AVX2, SSE4.1 или скалярный вариант.
+namespace simd {
+
+enum class Backend {
+    SCALAR,
+    SSE4,
+    AVX2
+};
+
+struct Bounds {
+    double minX;
+    double maxX;
+    double minY;
+    double maxY;
+};
+
+// dst = clamp(src + normalize(dir) * step). Нулевой step оставляет NPC на месте.
+void moveBlock(const double* srcX, const double* srcY,
+               const double* dirX, const double* dirY,
+               const double* step,
+               double* dstX, double* dstY,
+               size_t count, const Bounds& bounds);
+
+void distancesSquared(double ax, double ay,
+                      const double* xs, const double* ys,
+                      double* out, size_t count);
+
+// Записывает в hits позиции кандидатов с квадратом расстояния <= radiusSq.
+size_t withinRadius(double ax, double ay,
+                    const double* xs, const double* ys,
+                    size_t count, double radiusSq,
+                    uint32_t* hits);
+
+Backend activeBackend();
+bool setBackend(Backend backend);
+const char* backendName(Backend backend);
+
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "npc_world.h"
+
+// Бинарный снимок мира. Заголовок (40 байт, little-endian):
+//   magic "LNPC", version u16, flags u16, count u64, nameBytes u64,
+//   payloadBytes u64, crc32 полезной нагрузки u32, reserved u32.
+// Нагрузка: x f64[count], y f64[count], смещения имён u32[count + 1],
+// kind u8[count], alive u8[count], байты имён.
+namespace snapshot {
+
+constexpr char MAGIC[4] = {'L', 'N', 'P', 'C'};
+constexpr uint16_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 40;
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+void encodeWorld(const NpcWorld& world, std::vector<uint8_t>& out);
+// Читает снимок из начала data; consumed — сколько байт он занял.
+bool decodeWorld(std::span<const uint8_t> data, NpcWorld& world, std::string& error, size_t* consumed = nullptr);
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+// Равномерная сетка поверх карты. Размер ячейки не меньше максимальной
+// дистанции атаки, поэтому все цели лежат в соседних 3x3 ячейках.
+class SpatialGrid {
+public:
+    static constexpr size_t NO_CELL = static_cast<size_t>(-1);
+
+private:
+    double minX;
+    double minY;
+    double cellSize;
+    size_t cols;
+    size_t rows;
+    std::vector<std::vector<uint32_t>> cells;
+    std::vector<size_t> cellOfId;
+    std::vector<uint32_t> slotOfId;
+
+public:
+    SpatialGrid(double minX, double maxX, double minY, double maxY, double cellSize);
+
+    void insert(size_t id, double x, double y);
+    void update(size_t id, double x, double y);
+    void remove(size_t id);
+    void clear();
+
+    size_t cellIndex(double x, double y) const;
+    double getCellSize() const { return cellSize; }
+    size_t getCols() const { return cols; }
+    size_t getRows() const { return rows; }
+    const std::vector<uint32_t>& cell(size_t index) const { return cells[index]; }
+
+    template<typename Fn>
+    void forEachNear(double x, double y, double radius, Fn&& fn) const {
+        long reach = static_cast<long>(std::ceil(radius / cellSize));
+        long cx = cellCoord(x - minX, cols);
+        long cy = cellCoord(y - minY, rows);
+        long x0 = std::max(0L, cx - reach);
+        long x1 = std::min(static_cast<long>(cols) - 1, cx + reach);
+        long y0 = std::max(0L, cy - reach);
+        long y1 = std::min(static_cast<long>(rows) - 1, cy + reach);
+        for (long gy = y0; gy <= y1; gy++) {
+            for (long gx = x0; gx <= x1; gx++) {
+                for (uint32_t id : cells[static_cast<size_t>(gy) * cols + static_cast<size_t>(gx)]) {
+                    fn(static_cast<size_t>(id));
+                }
+            }
+        }
+    }
+
+private:
+    long cellCoord(double offset, size_t limit) const {
+        long c = static_cast<long>(offset / cellSize);
+        if (c < 0) return 0;
+        if (c >= static_cast<long>(limit)) return static_cast<long>(limit) - 1;
+        return c;
+    }
+};
+
+#endif
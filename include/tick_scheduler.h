@@ -0,0 +1,71 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+enum class TickPhase {
+    MOVE,
+    DETECT,
+    RESOLVE,
+    OBSERVE,
+    COUNT
+};
+
+constexpr size_t TICK_PHASE_COUNT = static_cast<size_t>(TickPhase::COUNT);
+
+const char* tickPhaseName(TickPhase phase);
+
+// Планировщик с фиксированным шагом: каждый тик выполняет фазы по порядку и
+// спит до следующего дедлайна. Частота 0 — режим «как можно быстрее».
+class TickScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using PhaseFn = std::function<void(uint64_t tick)>;
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t overruns = 0;
+        double budgetMs = 0.0;
+        double lastTickMs = 0.0;
+        double maxTickMs = 0.0;
+        double avgTickMs = 0.0;
+        std::array<double, TICK_PHASE_COUNT> lastPhaseMs{};
+        std::array<double, TICK_PHASE_COUNT> maxPhaseMs{};
+    };
+
+private:
+    std::array<PhaseFn, TICK_PHASE_COUNT> phases;
+    // Меняется из любого потока (GameEngine::setTickRate) во время run().
+    std::atomic<double> ticksPerSecond{0.0};
+    std::atomic<uint64_t> completedTicks{0};
+    mutable std::mutex statsMutex;
+    Stats stats;
+    double totalTickMs = 0.0;
+
+    void record(double tickMs, const std::array<double, TICK_PHASE_COUNT>& phaseMs);
+
+public:
+    explicit TickScheduler(double ticksPerSecond = 20.0);
+
+    void setPhase(TickPhase phase, PhaseFn fn);
+    void setTickRate(double rate);
+    double getTickRate() const { return ticksPerSecond.load(std::memory_order_relaxed); }
+    bool isRealTime() const { return getTickRate() > 0.0; }
+
+    uint64_t currentTick() const { return completedTicks.load(); }
+    void setCurrentTick(uint64_t tick) { completedTicks.store(tick); }
+
+    // Выполняет один тик без ожидания; true, если тик превысил бюджет.
+    bool step();
+    uint64_t run(uint64_t maxTicks, const std::atomic<bool>& running);
+
+    Stats getStats() const;
+    void resetStats();
+};
+
+#endif
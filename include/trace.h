@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Трассировка в формате Chrome trace_event (chrome://tracing, Perfetto).
+// Каждый поток пишет завершённые интервалы в своё кольцо без блокировок;
+// при переполнении затираются самые старые. writeChromeJson вызывается,
+// когда пишущие потоки уже остановлены.
+//
+// Макросы TRACE_* собираются, только если задан LABS_TRACING (CMake-опция
+// LABS_ENABLE_TRACING), иначе они пустые. Имена — строковые литералы:
+// сохраняется указатель, а не копия.
+namespace trace {
+
+#ifdef LABS_TRACING
+constexpr bool COMPILED_IN = true;
+#else
+constexpr bool COMPILED_IN = false;
+#endif
+
+constexpr size_t RING_CAPACITY = size_t(1) << 16;
+
+inline std::atomic<bool> recording{false};
+
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Очищает кольца и начинает запись; start/stop — между запусками потоков.
+void start();
+void stop();
+void setThreadName(const std::string& name);
+void record(const char* name, uint64_t startNs, uint64_t endNs);
+bool writeChromeJson(const std::string& filename);
+// Сколько интервалов затёрто при переполнении колец с последнего start.
+size_t droppedCount();
+// Сколько колец выделено за всё время; кольца завершившихся потоков переиспользуются.
+size_t ringCount();
+
+class Span {
+private:
+    const char* name;
+    uint64_t startNs = 0;
+    bool active;
+
+public:
+    explicit Span(const char* name) : name(name), active(recording.load(std::memory_order_relaxed)) {
+        if (active) startNs = nowNs();
+    }
+    ~Span() {
+        if (active) record(name, startNs, nowNs());
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+};
+
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef LABS_TRACING
+#define TRACE_SCOPE(name) ::trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) ::trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
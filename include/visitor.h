@@ -3,12 +3,19 @@
 
 #include <vector>
 #include <memory>
-#include <queue>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <unordered_set>
+#include <cstdint>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include "lock_stats.h"
 
 class NPC;
+class SpatialGrid;
 class Squirrel;
 class Werewolf;
 class Druid;
@@ -22,29 +29,88 @@ public:
 };
 
 struct BattleTask {
+    static constexpr size_t NO_ID = static_cast<size_t>(-1);
+    
     std::shared_ptr<NPC> attacker;
     std::shared_ptr<NPC> defender;
+    size_t attackerId = NO_ID;
+    size_t defenderId = NO_ID;
+    uint64_t tick = 0;
     
     BattleTask() : attacker(nullptr), defender(nullptr) {}
     
     BattleTask(std::shared_ptr<NPC> a, std::shared_ptr<NPC> d)
         : attacker(a), defender(d) {}
+    
+    BattleTask(std::shared_ptr<NPC> a, std::shared_ptr<NPC> d, size_t aId, size_t dId)
+        : attacker(a), defender(d), attackerId(aId), defenderId(dId) {}
+    
+    BattleTask(size_t aId, size_t dId, uint64_t tick = 0)
+        : attacker(nullptr), defender(nullptr), attackerId(aId), defenderId(dId), tick(tick) {}
+    
+    bool hasIds() const { return attackerId != NO_ID && defenderId != NO_ID; }
 };
 
+// Очередь боёв, разбитая на шарды по id защищающегося: каждый боевой поток
+// берёт задачи из своего шарда, а когда тот пуст — крадёт с хвоста чужих.
 class BattleQueue {
+public:
+    using StaleFilter = std::function<bool(const BattleTask&)>;
+    
 private:
-    std::queue<BattleTask> tasks;
-    mutable std::mutex mtx;
-    std::condition_variable cv;
-    bool stopFlag = false;
+    using ShardMutex = ProfiledMutex<LockClass::QUEUE_SHARD>;
+    using WaitMutex = ProfiledMutex<LockClass::QUEUE_WAIT>;
+    
+    struct Shard {
+        std::deque<BattleTask> tasks;
+        std::unordered_set<uint64_t> queuedPairs;
+        ShardMutex mtx;
+    };
+    
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> unfinished{0};
+    std::atomic<size_t> coalesced{0};
+    std::atomic<size_t> staleDropped{0};
+    std::atomic<bool> stopFlag{false};
+    bool coalescePairs;
+    StaleFilter isStale;
+    mutable WaitMutex mtx;
+    ConditionFor<WaitMutex> cv;
+    ConditionFor<WaitMutex> idleCv;
+    
+    bool pushLocked(Shard& shard, const BattleTask& task);
+    bool takeLocked(Shard& shard, BattleTask& task, bool fromBack);
+    bool popFrom(size_t shard, BattleTask& task, bool fromBack);
+    size_t popManyFrom(size_t shard, std::vector<BattleTask>& out, size_t maxCount, bool fromBack);
+    bool waitForWork(std::chrono::milliseconds timeout);
+    void wakeWorkers(size_t added);
+    void finish(size_t count);
+    static uint64_t pairKey(const BattleTask& task);
     
 public:
+    explicit BattleQueue(size_t shardCount = 1, bool coalescePairs = false);
+    
+    // Фильтр задаётся до запуска потоков: устаревшие задачи отбрасываются при выдаче.
+    void setStaleFilter(StaleFilter filter);
+    
     void addTask(const BattleTask& task);
+    void addTasks(std::span<const BattleTask> batch);
+    size_t drainInto(std::vector<BattleTask>& out, size_t maxCount, size_t worker = 0);
     bool tryGetTask(BattleTask& task);
+    bool tryGetTask(BattleTask& task, size_t worker);
+    // Воркер подтверждает обработанные задачи; waitUntilIdle ждёт, пока
+    // не останется ни поставленных в очередь, ни выполняемых задач.
+    void completeTasks(size_t count);
+    bool waitUntilIdle();
     void stop();
     bool isEmpty() const;
     bool shouldStop() const;
     size_t size() const;
+    size_t shardCount() const { return shards.size(); }
+    size_t shardFor(const BattleTask& task) const;
+    size_t coalescedCount() const { return coalesced.load(); }
+    size_t staleDroppedCount() const { return staleDropped.load(); }
 };
 
 class DetectionVisitor : public NPCVisitor {
@@ -52,11 +118,13 @@ private:
     std::vector<std::shared_ptr<NPC>>& npcs;
     BattleQueue& battleQueue;
     std::shared_ptr<NPC> currentNPC;
+    const SpatialGrid* grid;
     void detectForNPC(NPC* npc);
 public:
     DetectionVisitor(std::vector<std::shared_ptr<NPC>>& npcs, 
                      BattleQueue& queue, 
-                     std::shared_ptr<NPC> npc);
+                     std::shared_ptr<NPC> npc,
+                     const SpatialGrid* grid = nullptr);
     
     void visit(Squirrel* squirrel) override;
     void visit(Werewolf* werewolf) override;
@@ -1,17 +1,206 @@
 #include "include/game_engine.h"
 #include <iostream>
+#include <string>
+#include <stdexcept>
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --headless           no map, no console log; print a JSON summary at the end\n"
+              << "  --ansi               redraw the map in place, sending only changed cells\n"
+              << "  --density            draw NPC density per cell instead of individual NPCs\n"
+              << "  --view X,Y,ZOOM      map viewport centre and zoom (default: whole map)\n"
+              << "  --view-size WxH      map viewport size in characters (default 50x20)\n"
+              << "  --npcs N             number of NPCs (default 50)\n"
+              << "  --load FILE          start from a saved NPC file instead of random NPCs\n"
+              << "  --map WxH            map size (default 100x100)\n"
+              << "  --mix S:W:D          species weights for squirrels, werewolves, druids (default 1:1:1)\n"
+              << "  --ticks N            number of ticks to simulate (default 600)\n"
+              << "  --tick-rate R        ticks per second, 0 = as fast as possible\n"
+              << "                       (default 20, headless default 0)\n"
+              << "  --seed N             RNG seed for reproducible runs\n"
+              << "  --threads N          battle worker threads (default 2)\n"
+              << "  --phase-threads N    threads for the movement and detection phases (default 0 = all cores)\n"
+              << "  --log FILE           battle log file, empty to disable\n"
+              << "                       (default game_log.txt, headless default none)\n"
+              << "  --checkpoint FILE    write a checkpoint at the end (and every --checkpoint-every ticks)\n"
+              << "  --checkpoint-every N checkpoint period in ticks\n"
+              << "  --resume FILE        continue from a checkpoint; --ticks is then the final tick\n"
+              << "  --event-log FILE     binary battle event log (decode with battle_log_decode)\n"
+              << "  --profile-every N    print phase latency percentiles to stderr every N ticks\n"
+              << "                       (0 = off, headless default 100)\n"
+              << "  --trace FILE         write a Chrome trace_event JSON (needs -DLABS_ENABLE_TRACING=ON)\n";
+}
+
+std::string requireValue(int argc, char** argv, int& i) {
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(std::string("missing value for ") + argv[i]);
+    }
+    return argv[++i];
+}
+
+unsigned long long parseCount(const std::string& text, const std::string& option) {
+    size_t used = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != text.size() || text.empty() || text[0] == '-') {
+        throw std::invalid_argument("invalid value '" + text + "' for " + option);
+    }
+    return value;
+}
+
+double parseNumber(const std::string& text, const std::string& option) {
+    size_t used = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != text.size() || text.empty() || value < 0.0) {
+        throw std::invalid_argument("invalid value '" + text + "' for " + option);
+    }
+    return value;
+}
+
+GameConfig parseArgs(int argc, char** argv, bool& showHelp) {
+    GameConfig config;
+    bool tickRateSet = false;
+    bool logSet = false;
+    bool profileSet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            showHelp = true;
+        } else if (arg == "--headless") {
+            config.headless = true;
+        } else if (arg == "--ansi") {
+            config.ansiMap = true;
+        } else if (arg == "--density") {
+            config.densityMap = true;
+        } else if (arg == "--view") {
+            std::string value = requireValue(argc, argv, i);
+            size_t first = value.find(',');
+            size_t second = first == std::string::npos ? first : value.find(',', first + 1);
+            if (second == std::string::npos) {
+                throw std::invalid_argument("--view expects X,Y,ZOOM, got '" + value + "'");
+            }
+            config.viewport.centerX = parseNumber(value.substr(0, first), arg);
+            config.viewport.centerY = parseNumber(value.substr(first + 1, second - first - 1), arg);
+            config.viewport.zoom = parseNumber(value.substr(second + 1), arg);
+            if (config.viewport.zoom < 1.0) {
+                throw std::invalid_argument("--view zoom must be at least 1");
+            }
+        } else if (arg == "--view-size") {
+            std::string value = requireValue(argc, argv, i);
+            size_t sep = value.find('x');
+            if (sep == std::string::npos) {
+                throw std::invalid_argument("--view-size expects WxH, got '" + value + "'");
+            }
+            config.viewport.width = parseCount(value.substr(0, sep), arg);
+            config.viewport.height = parseCount(value.substr(sep + 1), arg);
+            if (config.viewport.width == 0 || config.viewport.height == 0) {
+                throw std::invalid_argument("--view-size must be at least 1x1");
+            }
+        } else if (arg == "--npcs") {
+            config.npcCount = parseCount(requireValue(argc, argv, i), arg);
+        } else if (arg == "--load") {
+            config.loadFile = requireValue(argc, argv, i);
+        } else if (arg == "--map") {
+            std::string value = requireValue(argc, argv, i);
+            size_t sep = value.find('x');
+            if (sep == std::string::npos) {
+                throw std::invalid_argument("--map expects WxH, got '" + value + "'");
+            }
+            config.mapMaxX = config.mapMinX + parseNumber(value.substr(0, sep), arg);
+            config.mapMaxY = config.mapMinY + parseNumber(value.substr(sep + 1), arg);
+            if (config.mapMaxX <= config.mapMinX + 2 || config.mapMaxY <= config.mapMinY + 2) {
+                throw std::invalid_argument("--map must be larger than 2x2");
+            }
+        } else if (arg == "--mix") {
+            std::string value = requireValue(argc, argv, i);
+            size_t start = 0;
+            for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+                size_t end = value.find(':', start);
+                if ((end == std::string::npos) != (k + 1 == NPC_KIND_COUNT)) {
+                    throw std::invalid_argument("--mix expects S:W:D, got '" + value + "'");
+                }
+                config.speciesMix[k] = parseNumber(value.substr(start, end - start), arg);
+                start = end + 1;
+            }
+        } else if (arg == "--ticks") {
+            config.ticks = parseCount(requireValue(argc, argv, i), arg);
+        } else if (arg == "--tick-rate") {
+            config.tickRate = parseNumber(requireValue(argc, argv, i), arg);
+            tickRateSet = true;
+        } else if (arg == "--seed") {
+            config.seed = parseCount(requireValue(argc, argv, i), arg);
+            config.hasSeed = true;
+        } else if (arg == "--threads") {
+            config.threads = parseCount(requireValue(argc, argv, i), arg);
+            if (config.threads == 0) {
+                throw std::invalid_argument("--threads must be at least 1");
+            }
+        } else if (arg == "--phase-threads") {
+            config.phaseThreads = parseCount(requireValue(argc, argv, i), arg);
+        } else if (arg == "--checkpoint") {
+            config.checkpointFile = requireValue(argc, argv, i);
+        } else if (arg == "--checkpoint-every") {
+            config.checkpointEvery = parseCount(requireValue(argc, argv, i), arg);
+        } else if (arg == "--resume") {
+            config.resumeFile = requireValue(argc, argv, i);
+        } else if (arg == "--event-log") {
+            config.eventLogFile = requireValue(argc, argv, i);
+        } else if (arg == "--trace") {
+            config.traceFile = requireValue(argc, argv, i);
+            if (!trace::COMPILED_IN) {
+                std::cerr << "Warning: built without LABS_ENABLE_TRACING, --trace is ignored" << std::endl;
+            }
+        } else if (arg == "--profile-every") {
+            config.profileEvery = parseCount(requireValue(argc, argv, i), arg);
+            profileSet = true;
+        } else if (arg == "--log") {
+            config.logFile = requireValue(argc, argv, i);
+            logSet = true;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+
+    if (config.headless) {
+        if (!tickRateSet) config.tickRate = 0.0;
+        if (!logSet) config.logFile.clear();
+        if (!profileSet) config.profileEvery = 100;
+    }
+    return config;
+}
+
+}
+
+int main(int argc, char** argv) {
 
-int main() {
-    
     try {
-        GameEngine engine;
+        bool showHelp = false;
+        GameConfig config = parseArgs(argc, argv, showHelp);
+        if (showHelp) {
+            printUsage(argv[0]);
+            return 0;
+        }
+
+        GameEngine engine(config);
         engine.initializeGame();
         engine.run();
-        
+
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-    
+
     return 0;
 }
\ No newline at end of file
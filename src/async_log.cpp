@@ -0,0 +1,241 @@
+#include "../include/async_log.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+}
+
+AsyncLogWriter::AsyncLogWriter(const std::string& path, const Options& opts)
+    : mask(roundUpToPowerOfTwo(opts.capacity) - 1), options(opts) {
+    ring = std::make_unique<Record[]>(mask + 1);
+    for (size_t i = 0; i <= mask; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: cannot open log file " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    writer = std::thread(&AsyncLogWriter::writerLoop, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    stopFlag.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wakeCv.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool AsyncLogWriter::tryPush(std::time_t time, std::string_view line) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Record& record = ring[pos & mask];
+        size_t seq = record.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                size_t length = std::min(line.size(), RECORD_TEXT_SIZE);
+                std::memcpy(record.text.data(), line.data(), length);
+                record.length = static_cast<uint16_t>(length);
+                record.truncated = length < line.size();
+                record.time = time;
+                record.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AsyncLogWriter::push(std::string_view line) {
+    if (fd < 0) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // Перевод строки добавляет писатель.
+    while (!line.empty() && line.back() == '\n') {
+        line.remove_suffix(1);
+    }
+
+    if (line.size() > RECORD_TEXT_SIZE) {
+        truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::time_t now = std::time(nullptr);
+    if (!tryPush(now, line)) {
+        if (options.policy == OverflowPolicy::DROP) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        while (!tryPush(now, line)) {
+            std::this_thread::yield();
+        }
+    }
+    wakeWriter();
+    return true;
+}
+
+bool AsyncLogWriter::hasPending() const {
+    return ring[dequeuePos & mask].sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+}
+
+void AsyncLogWriter::wakeWriter() {
+    // Пара к seq_cst-записи writerIdle в писателе: либо он увидит новую запись
+    // при проверке перед сном, либо мы увидим, что он спит.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!writerIdle.load(std::memory_order_relaxed)) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wakeCv.notify_one();
+}
+
+void AsyncLogWriter::publishDurable() {
+    if (durablePos.load(std::memory_order_relaxed) == dequeuePos) return;
+    durablePos.store(dequeuePos, std::memory_order_seq_cst);
+    if (flushWaiters.load(std::memory_order_seq_cst) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        durableCv.notify_all();
+    }
+}
+
+bool AsyncLogWriter::popOne(std::string& out, std::time_t& lastTime, std::string& stamp) {
+    Record& record = ring[dequeuePos & mask];
+    size_t seq = record.sequence.load(std::memory_order_acquire);
+    if (seq != dequeuePos + 1) {
+        return false;
+    }
+
+    // Метку времени форматируем здесь, а не в боевом потоке, и только раз в секунду.
+    if (record.time != lastTime || stamp.empty()) {
+        lastTime = record.time;
+        std::tm timeinfo{};
+        localtime_r(&lastTime, &timeinfo);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "[%Y-%m-%d %H:%M:%S] ", &timeinfo);
+        stamp = buffer;
+    }
+    out += stamp;
+    out.append(record.text.data(), record.length);
+    if (record.truncated) {
+        out += TRUNCATED_MARK;
+    }
+    out += '\n';
+
+    record.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+void AsyncLogWriter::writeOut(std::string& buffer) {
+    TRACE_SCOPE("log_write");
+    const char* data = buffer.data();
+    size_t left = buffer.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, data, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: log write failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+    }
+    buffer.clear();
+    flushes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogWriter::writerLoop() {
+    using Clock = std::chrono::steady_clock;
+    TRACE_THREAD_NAME("log-writer");
+
+    std::string buffer;
+    buffer.reserve(options.flushBytes + RECORD_TEXT_SIZE + 32);
+    std::string stamp;
+    std::time_t lastTime = 0;
+    size_t buffered = 0;
+    auto lastFlush = Clock::now();
+
+    while (true) {
+        bool stopping = stopFlag.load(std::memory_order_acquire);
+        size_t drained = 0;
+        while (popOne(buffer, lastTime, stamp)) {
+            drained++;
+            buffered++;
+            if (buffer.size() >= options.flushBytes) {
+                writeOut(buffer);
+                written.fetch_add(buffered, std::memory_order_relaxed);
+                buffered = 0;
+                lastFlush = Clock::now();
+            }
+        }
+
+        bool requested = flushWanted.exchange(false, std::memory_order_acq_rel);
+        if (!buffer.empty() && (stopping || requested || Clock::now() - lastFlush >= options.flushInterval)) {
+            writeOut(buffer);
+            written.fetch_add(buffered, std::memory_order_relaxed);
+            buffered = 0;
+            lastFlush = Clock::now();
+        }
+        if (buffer.empty()) {
+            publishDurable();
+        }
+
+        if (stopping && drained == 0) {
+            break;
+        }
+        if (drained == 0) {
+            writerIdle.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            auto ready = [this]() {
+                return stopFlag.load(std::memory_order_acquire) || flushWanted.load(std::memory_order_acquire) ||
+                       hasPending();
+            };
+            if (buffer.empty()) {
+                wakeCv.wait(lock, ready);
+            } else {
+                wakeCv.wait_until(lock, lastFlush + options.flushInterval, ready);
+            }
+            writerIdle.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogWriter::flush() {
+    if (fd < 0) return;
+    size_t target = enqueuePos.load(std::memory_order_acquire);
+    if (durablePos.load(std::memory_order_acquire) >= target) return;
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    flushWaiters.fetch_add(1, std::memory_order_seq_cst);
+    flushWanted.store(true, std::memory_order_release);
+    wakeCv.notify_one();
+    durableCv.wait(lock, [&]() { return durablePos.load(std::memory_order_seq_cst) >= target; });
+    flushWaiters.fetch_sub(1, std::memory_order_relaxed);
+}
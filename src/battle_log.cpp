@@ -0,0 +1,245 @@
+#include "../include/battle_log.h"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 4 + 2 + 2 + 8 + 4 * 8;
+constexpr double QUANT_MAX = 65535.0;
+constexpr uint8_t KILLED_BIT = 0x40;
+constexpr uint8_t ALREADY_DEAD_BIT = 0x80;
+
+void putLE(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t getLE(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Координаты версии 1.
+double dequantize(uint16_t value, double lo, double hi) {
+    return lo + (hi - lo) * (value / QUANT_MAX);
+}
+
+const char* kindName(NPCKind kind) {
+    return static_cast<size_t>(kind) < NPC_KIND_COUNT ? speciesTraits(kind).name : "Unknown";
+}
+
+}
+
+std::string formatBattleEvent(const BattleEvent& event) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "tick " << event.tick << ": "
+       << kindName(event.attackerKind) << " #" << event.attackerId
+       << " (" << event.attackerX << ", " << event.attackerY << ") attacks "
+       << kindName(event.defenderKind) << " #" << event.defenderId
+       << " (" << event.defenderX << ", " << event.defenderY << "), rolls "
+       << static_cast<int>(event.attackRoll) << " vs " << static_cast<int>(event.defenseRoll)
+       << (event.killed ? ", killed" : event.targetAlreadyDead ? ", target already dead" : ", survived");
+    return ss.str();
+}
+
+const char* battleEventCsvHeader() {
+    return "tick,attacker_id,attacker_type,attacker_x,attacker_y,"
+           "defender_id,defender_type,defender_x,defender_y,attack_roll,defense_roll,killed,already_dead";
+}
+
+std::string formatBattleEventCsv(const BattleEvent& event) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << event.tick << ","
+       << event.attackerId << "," << kindName(event.attackerKind) << ","
+       << event.attackerX << "," << event.attackerY << ","
+       << event.defenderId << "," << kindName(event.defenderKind) << ","
+       << event.defenderX << "," << event.defenderY << ","
+       << static_cast<int>(event.attackRoll) << "," << static_cast<int>(event.defenseRoll) << ","
+       << (event.killed ? 1 : 0) << "," << (event.targetAlreadyDead ? 1 : 0);
+    return ss.str();
+}
+
+bool BattleEventWriter::open(const std::string& filename, const BattleLogHeader& logHeader) {
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open file " << filename << " for writing" << std::endl;
+        return false;
+    }
+    header = logHeader;
+    prevTick = 0;
+    prevDefender = 0;
+    events = 0;
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), BattleLogHeader::MAGIC, BattleLogHeader::MAGIC + 4);
+    putLE(out, header.version, 2);
+    putLE(out, 0, 2);
+    putLE(out, header.seed, 8);
+    for (double bound : {header.minX, header.maxX, header.minY, header.maxY}) {
+        putLE(out, std::bit_cast<uint64_t>(bound), 8);
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    bytes = out.size();
+    return true;
+}
+
+void BattleEventWriter::append(const BattleEvent& event) {
+    pending.push_back(event);
+}
+
+void BattleEventWriter::append(std::span<const BattleEvent> batch) {
+    pending.insert(pending.end(), batch.begin(), batch.end());
+}
+
+void BattleEventWriter::encode(const BattleEvent& event) {
+    if (event.tick != prevTick) {
+        prevDefender = 0;
+    }
+    putVarint(encoded, zigzag(static_cast<int64_t>(event.tick - prevTick)));
+    putVarint(encoded, zigzag(static_cast<int64_t>(event.defenderId) - static_cast<int64_t>(prevDefender)));
+    putVarint(encoded, event.attackerId);
+    encoded.push_back(static_cast<uint8_t>(static_cast<uint8_t>(event.attackerKind) |
+                                           (static_cast<uint8_t>(event.defenderKind) << 4)));
+    encoded.push_back(static_cast<uint8_t>((event.attackRoll & 0x7) | ((event.defenseRoll & 0x7) << 3) |
+                                           (event.killed ? KILLED_BIT : 0) |
+                                           (event.targetAlreadyDead ? ALREADY_DEAD_BIT : 0)));
+    for (double coordinate : {event.attackerX, event.attackerY, event.defenderX, event.defenderY}) {
+        putLE(encoded, std::bit_cast<uint32_t>(static_cast<float>(coordinate)), 4);
+    }
+    prevTick = event.tick;
+    prevDefender = event.defenderId;
+}
+
+void BattleEventWriter::flush() {
+    if (pending.empty() || !file.is_open()) return;
+
+    // Порядок внутри тика зависит от потоков — сортируем, чтобы журнал
+    // не зависел от планирования и лучше сжимался дельтами.
+    std::sort(pending.begin(), pending.end(), [](const BattleEvent& a, const BattleEvent& b) {
+        if (a.tick != b.tick) return a.tick < b.tick;
+        if (a.defenderId != b.defenderId) return a.defenderId < b.defenderId;
+        return a.attackerId < b.attackerId;
+    });
+
+    encoded.clear();
+    for (const auto& event : pending) {
+        encode(event);
+    }
+    file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+    file.flush();
+    events += pending.size();
+    bytes += encoded.size();
+    pending.clear();
+}
+
+void BattleEventWriter::close() {
+    flush();
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+bool BattleEventReader::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open file " << filename << " for reading" << std::endl;
+        return false;
+    }
+
+    uint8_t raw[HEADER_SIZE];
+    if (!file.read(reinterpret_cast<char*>(raw), HEADER_SIZE) ||
+        !std::equal(raw, raw + 4, BattleLogHeader::MAGIC)) {
+        std::cerr << "Error: " << filename << " is not a battle event log" << std::endl;
+        file.close();
+        return false;
+    }
+    logHeader.version = static_cast<uint16_t>(getLE(raw + 4, 2));
+    if (logHeader.version != BattleLogHeader::VERSION && logHeader.version != BattleLogHeader::QUANTIZED_VERSION) {
+        std::cerr << "Error: unsupported battle log version " << logHeader.version << std::endl;
+        file.close();
+        return false;
+    }
+    logHeader.seed = getLE(raw + 8, 8);
+    logHeader.minX = std::bit_cast<double>(getLE(raw + 16, 8));
+    logHeader.maxX = std::bit_cast<double>(getLE(raw + 24, 8));
+    logHeader.minY = std::bit_cast<double>(getLE(raw + 32, 8));
+    logHeader.maxY = std::bit_cast<double>(getLE(raw + 40, 8));
+    prevTick = 0;
+    prevDefender = 0;
+    return true;
+}
+
+bool BattleEventReader::readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = file.get();
+        if (byte == std::char_traits<char>::eof()) return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool BattleEventReader::next(BattleEvent& event) {
+    uint64_t tickDelta, defenderDelta, attacker;
+    if (!file.is_open() || !readVarint(tickDelta)) return false;
+    if (!readVarint(defenderDelta) || !readVarint(attacker)) return false;
+
+    bool quantized = logHeader.version == BattleLogHeader::QUANTIZED_VERSION;
+    uint8_t rest[2 + 4 * 4];
+    size_t restSize = quantized ? 2 + 4 * 2 : sizeof(rest);
+    if (!file.read(reinterpret_cast<char*>(rest), static_cast<std::streamsize>(restSize))) return false;
+
+    event.tick = prevTick + static_cast<uint64_t>(unzigzag(tickDelta));
+    if (event.tick != prevTick) {
+        prevDefender = 0;
+    }
+    event.defenderId = static_cast<uint32_t>(static_cast<int64_t>(prevDefender) + unzigzag(defenderDelta));
+    event.attackerId = static_cast<uint32_t>(attacker);
+    event.attackerKind = static_cast<NPCKind>(rest[0] & 0x0F);
+    event.defenderKind = static_cast<NPCKind>(rest[0] >> 4);
+    event.attackRoll = rest[1] & 0x7;
+    event.defenseRoll = (rest[1] >> 3) & 0x7;
+    event.killed = (rest[1] & KILLED_BIT) != 0;
+    event.targetAlreadyDead = (rest[1] & ALREADY_DEAD_BIT) != 0;
+    if (quantized) {
+        event.attackerX = dequantize(static_cast<uint16_t>(getLE(rest + 2, 2)), logHeader.minX, logHeader.maxX);
+        event.attackerY = dequantize(static_cast<uint16_t>(getLE(rest + 4, 2)), logHeader.minY, logHeader.maxY);
+        event.defenderX = dequantize(static_cast<uint16_t>(getLE(rest + 6, 2)), logHeader.minX, logHeader.maxX);
+        event.defenderY = dequantize(static_cast<uint16_t>(getLE(rest + 8, 2)), logHeader.minY, logHeader.maxY);
+    } else {
+        event.attackerX = std::bit_cast<float>(static_cast<uint32_t>(getLE(rest + 2, 4)));
+        event.attackerY = std::bit_cast<float>(static_cast<uint32_t>(getLE(rest + 6, 4)));
+        event.defenderX = std::bit_cast<float>(static_cast<uint32_t>(getLE(rest + 10, 4)));
+        event.defenderY = std::bit_cast<float>(static_cast<uint32_t>(getLE(rest + 14, 4)));
+    }
+
+    prevTick = event.tick;
+    prevDefender = event.defenderId;
+    return true;
+}
@@ -1,17 +1,73 @@
 #include "../include/game_engine.h"
 #include "../include/npc_factory.h"
+#include "../include/simd_kernels.h"
+#include "../include/snapshot.h"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
-#include <random>
 #include <algorithm>
 #include <sstream>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
 
-GameEngine::GameEngine() 
-    : gameRunning(false), elapsedTime(0) {
+namespace {
+
+constexpr char CHECKPOINT_MAGIC[4] = {'L', 'C', 'K', 'P'};
+constexpr uint16_t CHECKPOINT_VERSION = 1;
+constexpr size_t CHECKPOINT_HEADER_SIZE = 24;
+
+template<typename T>
+void putValue(std::vector<uint8_t>& out, T value) {
+    size_t pos = out.size();
+    out.resize(pos + sizeof(T));
+    std::memcpy(out.data() + pos, &value, sizeof(T));
+}
+
+template<typename T>
+bool takeValue(std::span<const uint8_t>& in, T& value) {
+    if (in.size() < sizeof(T)) return false;
+    std::memcpy(&value, in.data(), sizeof(T));
+    in = in.subspan(sizeof(T));
+    return true;
+}
+
+}
+
+GameEngine::GameEngine(const GameConfig& config) 
+    : config(config),
+      seed(config.hasSeed ? config.seed : RngService::globalSeed()),
+      phaseRunner(config.phaseThreads),
+      battleQueue(std::max<size_t>(1, config.threads), true),
+      battleWorkerCount(std::max<size_t>(1, config.threads)),
+      lethalHits(battleWorkerCount),
+      loggedBattles(battleWorkerCount),
+      scheduler(config.tickRate),
+      profiler(battleWorkerCount + 1),
+      renderer(config.ansiMap ? MapRenderer::Mode::ANSI : MapRenderer::Mode::TEXT, config.viewport),
+      gameRunning(false), elapsedTime(0) {
     
-    battleLogger.attach(new ConsoleLogger());
-    battleLogger.attach(new FileLogger("game_log.txt"));
+    battleQueue.setStaleFilter([this](const BattleTask& task) {
+        return task.hasIds() && (!world.isAlive(task.attackerId) || !world.isAlive(task.defenderId));
+    });
+    setupPhases();
+    
+    if (config.densityMap) {
+        renderer.setStyle(MapRenderer::Style::DENSITY);
+    }
+    renderer.setRunner(&phaseRunner);
+    
+    battleLogger.attach(&battleStats);
+    // Построчный вывод убийств сбил бы позиционирование курсора ANSI-карты.
+    if (!config.headless && !config.ansiMap) {
+        battleLogger.attach(std::make_shared<ConsoleLogger>(&coutMutex));
+    }
+    if (!config.logFile.empty()) {
+        fileLogger = std::make_shared<FileLogger>(config.logFile);
+        battleLogger.attach(fileLogger);
+    }
 }
 
 GameEngine::~GameEngine() {
@@ -19,63 +75,189 @@ GameEngine::~GameEngine() {
 }
 template<typename T>
 void GameEngine::safePrint(const T& message) const {
-    std::lock_guard<std::mutex> lock(coutMutex);
+    if (config.headless) return;
+    TRACE_SCOPE("safe_print");
+    std::lock_guard<ConsoleMutex> lock(coutMutex);
     std::cout << message;
 }
 
 void GameEngine::initializeGame() {
-    safePrint("Initializing game with " + std::to_string(NPC_COUNT) + " NPCs...\n");
+    if (!config.resumeFile.empty()) {
+        if (!restoreCheckpoint(config.resumeFile)) {
+            throw std::runtime_error("cannot resume from " + config.resumeFile);
+        }
+        safePrint("Resumed " + std::to_string(world.size()) + " NPCs at tick " +
+                  std::to_string(scheduler.currentTick()) + "\n");
+    } else if (config.loadFile.empty()) {
+        safePrint("Initializing game with " + std::to_string(config.npcCount) + " NPCs...\n");
+        createRandomNPCs();
+    } else {
+        loadNPCs();
+    }
+    buildObjects();
+    buildSpatialIndex();
+    renderer.setBounds(config.mapMinX, config.mapMaxX, config.mapMinY, config.mapMaxY);
     
-    createRandomNPCs();
+    if (!config.eventLogFile.empty()) {
+        BattleLogHeader header;
+        header.seed = seed;
+        header.minX = config.mapMinX;
+        header.maxX = config.mapMaxX;
+        header.minY = config.mapMinY;
+        header.maxY = config.mapMaxY;
+        eventLog.open(config.eventLogFile, header);
+    }
     
     safePrint("Game initialized. Starting threads...\n");
 }
 
 void GameEngine::createRandomNPCs() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> typeDist(0, 2);
-    std::uniform_real_distribution<> posDist(MAP_MIN_X + 1, MAP_MAX_X - 1);
-    
-    for (int i = 0; i < NPC_COUNT; i++) {
-        int type = typeDist(gen);
-        double x = posDist(gen);
-        double y = posDist(gen);
-        
-        std::shared_ptr<NPC> npc;
-        switch (type) {
-            case 0:
-                npc = std::make_shared<Squirrel>("Squirrel_" + std::to_string(i), x, y);
-                break;
-            case 1:
-                npc = std::make_shared<Werewolf>("Werewolf_" + std::to_string(i), x, y);
-                break;
-            case 2:
-                npc = std::make_shared<Druid>("Druid_" + std::to_string(i), x, y);
-                break;
+    RngStream gen = RngService::stream(seed, RngDomain::SPAWN, 0);
+    
+    double totalWeight = 0.0;
+    for (double weight : config.speciesMix) {
+        totalWeight += std::max(0.0, weight);
+    }
+    if (totalWeight <= 0.0) {
+        throw std::invalid_argument("species mix must contain a positive weight");
+    }
+    
+    world.clear();
+    world.reserve(config.npcCount);
+    for (size_t i = 0; i < config.npcCount; i++) {
+        double pick = gen.uniform() * totalWeight;
+        size_t kind = 0;
+        while (kind + 1 < NPC_KIND_COUNT && pick >= std::max(0.0, config.speciesMix[kind])) {
+            pick -= std::max(0.0, config.speciesMix[kind]);
+            kind++;
         }
+        double x = gen.uniform(config.mapMinX + 1, config.mapMaxX - 1);
+        double y = gen.uniform(config.mapMinY + 1, config.mapMaxY - 1);
         
+        NPCKind npcKind = static_cast<NPCKind>(kind);
+        world.add(npcKind, std::string(speciesTraits(npcKind).name) + "_" + std::to_string(i), x, y);
+    }
+}
+
+void GameEngine::loadNPCs() {
+    NPCFactory::LoadOptions options;
+    options.minX = config.mapMinX;
+    options.maxX = config.mapMaxX;
+    options.minY = config.mapMinY;
+    options.maxY = config.mapMaxY;
+    
+    NPCFactory::LoadReport report;
+    world.clear();
+    if (!NPCFactory::loadIntoWorld(config.loadFile, world, options, &report)) {
+        throw std::runtime_error("cannot load NPCs from " + config.loadFile);
+    }
+    if (report.badLines > 0) {
+        std::cerr << "Warning: skipped " << report.badLines << " invalid or out-of-map lines in "
+                  << config.loadFile << " (first at line " << report.badLineNumbers.front() << ")" << std::endl;
+    }
+    config.npcCount = world.size();
+    safePrint("Loaded " + std::to_string(world.size()) + " NPCs from " + config.loadFile + "\n");
+}
+
+void GameEngine::buildObjects() {
+    npcs.clear();
+    if (config.headless) return;
+    
+    const auto& positions = world.front();
+    npcs.reserve(world.size());
+    for (size_t i = 0; i < world.size(); i++) {
+        auto npc = NPCFactory::construct(world.kind(i), world.name(i), positions.x[i], positions.y[i]);
+        npc->setAlive(world.isAlive(i));
         npcs.push_back(npc);
     }
 }
 
+void GameEngine::buildSpatialIndex() {
+    spatialGrid = std::make_unique<SpatialGrid>(config.mapMinX, config.mapMaxX, config.mapMinY, config.mapMaxY,
+                                                world.maxAttackDistance());
+    const auto& positions = world.front();
+    for (size_t i = 0; i < world.size(); i++) {
+        if (world.isAlive(i)) {
+            spatialGrid->insert(i, positions.x[i], positions.y[i]);
+        }
+    }
+}
+
+void GameEngine::setupPhases() {
+    scheduler.setPhase(TickPhase::MOVE, [this](uint64_t tick) {
+        tickStart = TickProfiler::Clock::now();
+        TRACE_SCOPE("move");
+        movementPhase(tick);
+        profiler.record(0, ProfilePoint::MOVE, tickStart);
+    });
+    scheduler.setPhase(TickPhase::DETECT, [this](uint64_t tick) {
+        ScopedTimer timer(profiler.histogram(0, ProfilePoint::DETECT));
+        TRACE_SCOPE("detect");
+        detectionPhase(tick);
+    });
+    scheduler.setPhase(TickPhase::RESOLVE, [this](uint64_t tick) {
+        ScopedTimer timer(profiler.histogram(0, ProfilePoint::RESOLVE));
+        TRACE_SCOPE("resolve");
+        resolvePhase(tick);
+    });
+    scheduler.setPhase(TickPhase::OBSERVE, [this](uint64_t tick) {
+        {
+            ScopedTimer timer(profiler.histogram(0, ProfilePoint::OBSERVE));
+            TRACE_SCOPE("observe");
+            observePhase(tick);
+        }
+        // Время тика без сна до следующего дедлайна.
+        profiler.record(0, ProfilePoint::TICK, tickStart);
+        if (config.profileEvery > 0 && tick % config.profileEvery == 0) {
+            dumpProfile(tick);
+        }
+    });
+}
+
 void GameEngine::run() {
     gameRunning = true;
     elapsedTime = 0;
+    bool tracing = trace::COMPILED_IN && !config.traceFile.empty();
+    if (tracing) {
+        trace::start();
+    }
+    TRACE_THREAD_NAME("tick");
+    lockBaseline = lockstats::snapshot();
     
-    movementThread = std::thread(&GameEngine::movementWorker, this);
-    battleThread = std::thread(&GameEngine::battleWorker, this);
-    displayThread = std::thread(&GameEngine::displayWorker, this);
+    for (size_t i = 0; i < battleWorkerCount; i++) {
+        battleThreads.emplace_back(&GameEngine::battleWorker, this, i);
+    }
     
-    std::this_thread::sleep_for(std::chrono::seconds(GAME_DURATION));
+    runStarted = std::chrono::steady_clock::now();
+    nextMapSeconds = DISPLAY_INTERVAL;
+    uint64_t startTick = scheduler.currentTick();
+    scheduler.run(config.ticks > startTick ? config.ticks - startTick : 0, gameRunning);
     
     stop();
     
-    if (movementThread.joinable()) movementThread.join();
-    if (battleThread.joinable()) battleThread.join();
-    if (displayThread.joinable()) displayThread.join();
+    for (auto& thread : battleThreads) {
+        if (thread.joinable()) thread.join();
+    }
+    battleThreads.clear();
+    wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - runStarted).count();
+    
+    if (fileLogger) fileLogger->flush();
+    eventLog.close();
+    if (tracing) {
+        trace::stop();
+        trace::writeChromeJson(config.traceFile);
+    }
+    if (!config.checkpointFile.empty() && periodicCheckpointTick != scheduler.currentTick()) {
+        saveCheckpoint(config.checkpointFile);
+    }
     
-    printSurvivors();
+    world.syncTo(npcs);
+    lockUsage = lockstats::since(lockstats::snapshot(), lockBaseline);
+    if (config.headless) {
+        printSummary();
+    } else {
+        printSurvivors();
+    }
 }
 
 void GameEngine::stop() {
@@ -83,164 +265,430 @@ void GameEngine::stop() {
     battleQueue.stop();
 }
 
-void GameEngine::movementWorker() {
-    std::random_device rd;
-    std::mt19937 g(rd());
+size_t GameEngine::phaseChunkCount(size_t count) const {
+    size_t bySize = (count + MIN_PHASE_CHUNK - 1) / MIN_PHASE_CHUNK;
+    return std::max<size_t>(1, std::min(bySize, phaseRunner.threadCount() * CHUNKS_PER_THREAD));
+}
+
+void GameEngine::movementPhase(uint64_t tick) {
+    size_t count = world.size();
+    moveDirX.resize(count);
+    moveDirY.resize(count);
+    moveStep.resize(count);
     
-    while (gameRunning) {
-        std::vector<size_t> indices(npcs.size());
-        std::iota(indices.begin(), indices.end(), 0);
-        std::shuffle(indices.begin(), indices.end(), g);
-        
-        for (size_t idx : indices) {
-            auto& npc = npcs[idx];
-            if (!npc->isAlive()) continue;
-            
-            npc->move(MAP_MIN_X, MAP_MAX_X, MAP_MIN_Y, MAP_MAX_Y);
-            
-            DetectionVisitor detector(npcs, battleQueue, npc);
-            detector.detectBattles();
+    const auto& src = world.front();
+    auto& dst = world.back();
+    simd::Bounds bounds{config.mapMinX, config.mapMaxX, config.mapMinY, config.mapMaxY};
+    size_t chunks = phaseChunkCount(count);
+    phaseRunner.run(chunks, [&](size_t chunk) {
+        size_t begin = count * chunk / chunks;
+        size_t end = count * (chunk + 1) / chunks;
+        for (size_t i = begin; i < end; i++) {
+            if (world.isAlive(i)) {
+                // Один блок Philox на NPC за тик: направление зависит только от (seed, i, tick).
+                RngStream rng = RngService::stream(seed, RngDomain::MOVEMENT, i, tick);
+                moveDirX[i] = rng.uniform(-1.0, 1.0);
+                moveDirY[i] = rng.uniform(-1.0, 1.0);
+                moveStep[i] = world.traitsAt(i).moveDistance;
+            } else {
+                moveDirX[i] = 0.0;
+                moveDirY[i] = 0.0;
+                moveStep[i] = 0.0;
+            }
+        }
+        simd::moveBlock(src.x.data() + begin, src.y.data() + begin,
+                        moveDirX.data() + begin, moveDirY.data() + begin, moveStep.data() + begin,
+                        dst.x.data() + begin, dst.y.data() + begin, end - begin, bounds);
+    });
+    
+    world.swapBuffers();
+    
+    // Ячейки сетки общие для всех NPC, поэтому обновление остаётся последовательным.
+    const auto& moved = world.front();
+    for (size_t i = 0; i < count; i++) {
+        if (world.isAlive(i)) {
+            spatialGrid->update(i, moved.x[i], moved.y[i]);
+        } else {
+            spatialGrid->remove(i);
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 }
 
-void GameEngine::battleWorker() {
-    while (gameRunning || !battleQueue.isEmpty()) {
-        BattleTask task;
-        if (battleQueue.tryGetTask(task)) {
-            processBattle(task);
+void GameEngine::detectChunk(DetectChunk& chunk, size_t begin, size_t end, uint64_t tick) {
+    const auto& positions = world.front();
+    chunk.tasks.clear();
+    
+    for (size_t i = begin; i < end; i++) {
+        if (!world.isAlive(i) || !world.canAttackAnything(world.kind(i))) continue;
+        
+        double x = positions.x[i];
+        double y = positions.y[i];
+        double range = world.traitsAt(i).attackDistance;
+        
+        chunk.candidateX.clear();
+        chunk.candidateY.clear();
+        chunk.candidateIds.clear();
+        spatialGrid->forEachNear(x, y, range, [&](size_t j) {
+            if (j == i || !world.canAttack(i, j) || !world.isAlive(j)) return;
+            chunk.candidateX.push_back(positions.x[j]);
+            chunk.candidateY.push_back(positions.y[j]);
+            chunk.candidateIds.push_back(static_cast<uint32_t>(j));
+        });
+        if (chunk.candidateIds.empty()) continue;
+        
+        chunk.hitSlots.resize(chunk.candidateIds.size());
+        size_t hits = simd::withinRadius(x, y, chunk.candidateX.data(), chunk.candidateY.data(),
+                                         chunk.candidateIds.size(), range * range, chunk.hitSlots.data());
+        for (size_t h = 0; h < hits; h++) {
+            size_t j = chunk.candidateIds[chunk.hitSlots[h]];
+            chunk.tasks.emplace_back(i, j, tick);
         }
     }
-    
-    safePrint("Battle thread stopped.\n");
 }
 
-void GameEngine::processBattle(const BattleTask& task) {
-    auto attacker = task.attacker;
-    auto defender = task.defender;
+void GameEngine::detectionPhase(uint64_t tick) {
+    size_t count = world.size();
+    size_t chunks = phaseChunkCount(count);
+    if (detectChunks.size() < chunks) {
+        detectChunks.resize(chunks);
+    }
+    phaseRunner.run(chunks, [&](size_t chunk) {
+        detectChunk(detectChunks[chunk], count * chunk / chunks, count * (chunk + 1) / chunks, tick);
+    });
     
-    if (!attacker->isAlive() || !defender->isAlive()) {
-        return;
+    // Слияние в порядке кусков — тот же порядок задач, что и при обходе в один поток.
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        battleQueue.addTasks(detectChunks[chunk].tasks);
+    }
+}
+
+void GameEngine::resolvePhase(uint64_t) {
+    if (battleQueue.waitUntilIdle()) {
+        commitKills();
+    }
+}
+
+void GameEngine::observePhase(uint64_t tick) {
+    double rate = scheduler.getTickRate();
+    double seconds = rate > 0.0
+        ? static_cast<double>(tick) / rate
+        : std::chrono::duration<double>(std::chrono::steady_clock::now() - runStarted).count();
+    elapsedTime = static_cast<int>(seconds);
+    if (eventLog.isOpen()) {
+        TRACE_SCOPE("event_log_flush");
+        eventLog.flush();
+    }
+    writePendingCheckpoints(tick);
+    if (!config.headless && seconds >= nextMapSeconds) {
+        nextMapSeconds = (std::floor(seconds / DISPLAY_INTERVAL) + 1) * DISPLAY_INTERVAL;
+        printMap();
+    }
+}
+
+void GameEngine::writePendingCheckpoints(uint64_t tick) {
+    // Фаза разрешения уже дождалась боевых потоков, очередь пуста — граница тика.
+    if (!config.checkpointFile.empty() && config.checkpointEvery > 0 && tick % config.checkpointEvery == 0) {
+        if (saveCheckpoint(config.checkpointFile, tick)) {
+            periodicCheckpointTick = tick;
+        }
+    }
+    std::string requested;
+    {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        requested.swap(requestedCheckpoint);
+    }
+    if (!requested.empty()) {
+        saveCheckpoint(requested, tick);
     }
+}
+
+void GameEngine::requestCheckpoint(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    requestedCheckpoint = filename;
+}
+
+// Состояние ГСЧ — это seed и номер тика: все потоки случайных чисел
+// адресуются счётчиком, так что отдельно их сохранять не нужно.
+bool GameEngine::saveCheckpoint(const std::string& filename) const {
+    return saveCheckpoint(filename, scheduler.currentTick());
+}
+
+bool GameEngine::saveCheckpoint(const std::string& filename, uint64_t tick) const {
+    TRACE_SCOPE("checkpoint");
+    std::vector<uint8_t> out(CHECKPOINT_HEADER_SIZE);
+    putValue<uint64_t>(out, seed);
+    putValue<uint64_t>(out, tick);
+    for (double bound : {config.mapMinX, config.mapMaxX, config.mapMinY, config.mapMaxY}) {
+        putValue<double>(out, bound);
+    }
+    auto counters = battleStats.counters();
+    putValue<uint64_t>(out, counters.battles);
+    putValue<uint64_t>(out, counters.kills);
+    for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+        putValue<uint64_t>(out, counters.killsBy[k]);
+        putValue<uint64_t>(out, counters.lossesOf[k]);
+    }
+    snapshot::encodeWorld(world, out);
     
-    double distance = attacker->calculateDistance(defender.get());
-    if (distance > attacker->getAttackDistance()) {
-        return;
+    uint64_t payloadBytes = out.size() - CHECKPOINT_HEADER_SIZE;
+    uint32_t crc = snapshot::crc32(out.data() + CHECKPOINT_HEADER_SIZE, payloadBytes);
+    uint16_t version = CHECKPOINT_VERSION;
+    std::memcpy(out.data(), CHECKPOINT_MAGIC, 4);
+    std::memcpy(out.data() + 4, &version, sizeof(version));
+    std::memset(out.data() + 6, 0, 2);
+    std::memcpy(out.data() + 8, &payloadBytes, sizeof(payloadBytes));
+    std::memcpy(out.data() + 16, &crc, sizeof(crc));
+    std::memset(out.data() + 20, 0, 4);
+    
+    // Пишем во временный файл и переименовываем, чтобы сбой не испортил прошлую точку.
+    std::string tmpName = filename + ".tmp";
+    {
+        std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() ||
+            !file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+            std::cerr << "Error: Cannot write checkpoint " << tmpName << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Error: Cannot replace checkpoint " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool GameEngine::restoreCheckpoint(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open file " << filename << " for reading" << std::endl;
+        return false;
     }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     
-    if (!attacker->canAttack(defender.get())) {
-        return;
+    uint16_t version = 0;
+    uint64_t payloadBytes = 0;
+    uint32_t crc = 0;
+    if (data.size() >= CHECKPOINT_HEADER_SIZE) {
+        std::memcpy(&version, data.data() + 4, sizeof(version));
+        std::memcpy(&payloadBytes, data.data() + 8, sizeof(payloadBytes));
+        std::memcpy(&crc, data.data() + 16, sizeof(crc));
+    }
+    if (data.size() < CHECKPOINT_HEADER_SIZE || std::memcmp(data.data(), CHECKPOINT_MAGIC, 4) != 0 ||
+        version != CHECKPOINT_VERSION || payloadBytes != data.size() - CHECKPOINT_HEADER_SIZE) {
+        std::cerr << "Error: " << filename << " is not a valid checkpoint" << std::endl;
+        return false;
+    }
+    if (snapshot::crc32(data.data() + CHECKPOINT_HEADER_SIZE, payloadBytes) != crc) {
+        std::cerr << "Error: " << filename << ": checkpoint checksum mismatch" << std::endl;
+        return false;
     }
     
-    if (attacker->tryAttack(defender.get())) {
-        defender->setAlive(false);
-        
-        std::stringstream ss;
-        ss << attacker->getName() << " (" << attacker->getType() 
-           << ") killed " << defender->getName() << " (" << defender->getType() << ")\n";
-        safePrint(ss.str());
-        
-        battleLogger.logBattleEvent(ss.str());
+    std::span<const uint8_t> in(data.data() + CHECKPOINT_HEADER_SIZE, payloadBytes);
+    uint64_t savedSeed, tick;
+    BattleStatsObserver::Counters counters;
+    GameConfig restored = config;
+    bool ok = takeValue(in, savedSeed) && takeValue(in, tick) &&
+              takeValue(in, restored.mapMinX) && takeValue(in, restored.mapMaxX) &&
+              takeValue(in, restored.mapMinY) && takeValue(in, restored.mapMaxY);
+    uint64_t value = 0;
+    ok = ok && takeValue(in, value);
+    counters.battles = value;
+    ok = ok && takeValue(in, value);
+    counters.kills = value;
+    for (size_t k = 0; ok && k < NPC_KIND_COUNT; k++) {
+        ok = takeValue(in, value);
+        counters.killsBy[k] = value;
+        ok = ok && takeValue(in, value);
+        counters.lossesOf[k] = value;
     }
+    std::string error;
+    if (!ok || !snapshot::decodeWorld(in, world, error)) {
+        std::cerr << "Error: " << filename << ": " << (error.empty() ? "truncated checkpoint" : error) << std::endl;
+        return false;
+    }
+    
+    seed = savedSeed;
+    config.mapMinX = restored.mapMinX;
+    config.mapMaxX = restored.mapMaxX;
+    config.mapMinY = restored.mapMinY;
+    config.mapMaxY = restored.mapMaxY;
+    config.npcCount = world.size();
+    scheduler.setCurrentTick(tick);
+    battleStats.restore(counters);
+    return true;
 }
 
-void GameEngine::displayWorker() {
-    while (gameRunning && elapsedTime < GAME_DURATION) {
-        printMap();
-        
-        std::this_thread::sleep_for(std::chrono::seconds(DISPLAY_INTERVAL));
-        elapsedTime++;
+void GameEngine::battleWorker(size_t workerId) {
+    std::vector<BattleTask> batch;
+    batch.reserve(BATTLE_BATCH_SIZE);
+    LatencyHistogram& battleTime = profiler.histogram(workerId + 1, ProfilePoint::BATTLE);
+    TRACE_THREAD_NAME("battle-" + std::to_string(workerId));
+    
+    while (gameRunning || !battleQueue.isEmpty()) {
+        batch.clear();
+        auto waitStart = TickProfiler::Clock::now();
+        {
+            TRACE_SCOPE("queue_wait");
+            battleQueue.drainInto(batch, BATTLE_BATCH_SIZE, workerId);
+        }
+        profiler.record(workerId + 1, ProfilePoint::QUEUE_WAIT, waitStart);
+        for (const auto& task : batch) {
+            ScopedTimer timer(battleTime);
+            TRACE_SCOPE("battle");
+            processBattle(task, workerId);
+        }
+        battleQueue.completeTasks(batch.size());
     }
     
-    safePrint("Display thread stopped.\n");
+    safePrint("Battle thread " + std::to_string(workerId) + " stopped.\n");
 }
 
-void GameEngine::printMap() const {
-    const int MAP_WIDTH = 50;
-    const int MAP_HEIGHT = 20;
+void GameEngine::processBattle(const BattleTask& task, size_t workerId) {
+    if (!task.hasIds()) return;
     
-    char map[MAP_HEIGHT][MAP_WIDTH];
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            map[y][x] = '.';
-        }
+    size_t a = task.attackerId;
+    size_t d = task.defenderId;
+    if (!world.isAlive(a) || !world.isAlive(d) || !world.canAttack(a, d)) {
+        return;
     }
     
-    for (const auto& npc : npcs) {
-        if (npc->isAlive()) {
-            double npcX = npc->getX();
-            double npcY = npc->getY();
-            
-            int mapX = static_cast<int>((npcX - MAP_MIN_X) / (MAP_MAX_X - MAP_MIN_X) * (MAP_WIDTH - 1));
-            int mapY = static_cast<int>((npcY - MAP_MIN_Y) / (MAP_MAX_Y - MAP_MIN_Y) * (MAP_HEIGHT - 1));
-            
-            if (mapX >= 0 && mapX < MAP_WIDTH && mapY >= 0 && mapY < MAP_HEIGHT) {
-                map[mapY][mapX] = npc->getMapSymbol();
-            }
-        }
+    double range = world.traitsAt(a).attackDistance;
+    BattleEvent event;
+    bool inRange = world.readFront([&](const NpcWorld::Positions& positions) {
+        event.attackerX = positions.x[a];
+        event.attackerY = positions.y[a];
+        event.defenderX = positions.x[d];
+        event.defenderY = positions.y[d];
+        double dx = positions.x[a] - positions.x[d];
+        double dy = positions.y[a] - positions.y[d];
+        return dx * dx + dy * dy <= range * range;
+    });
+    if (!inRange) {
+        return;
     }
     
-    std::stringstream ss;
-    ss << "\n=== Time: " << elapsedTime << "s ===\n";
-    ss << std::string(MAP_WIDTH + 2, '-') << "\n";
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        ss << '|';
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            ss << map[y][x];
+    RngStream dice = RngService::stream(seed, RngDomain::BATTLE, (static_cast<uint64_t>(a) << 32) | d, task.tick);
+    int attackRoll = NPC::rollDice(dice);
+    int defenseRoll = NPC::rollDice(dice);
+    
+    event.tick = task.tick;
+    event.attackerId = static_cast<uint32_t>(a);
+    event.defenderId = static_cast<uint32_t>(d);
+    event.attackerKind = world.kind(a);
+    event.defenderKind = world.kind(d);
+    event.attackRoll = static_cast<uint8_t>(attackRoll);
+    event.defenseRoll = static_cast<uint8_t>(defenseRoll);
+    event.attackerName = world.name(a);
+    event.defenderName = world.name(d);
+    
+    // Убийства применяются в фазе разрешения: до её конца все бои тика
+    // видят состояние на начало тика, и исход не зависит от потоков.
+    if (attackRoll > defenseRoll) {
+        lethalHits[workerId].push_back(event);
+    } else {
+        if (eventLog.isOpen()) {
+            loggedBattles[workerId].push_back(event);
         }
-        ss << "|\n";
+        battleLogger.logBattleEvent(event);
     }
-    ss << std::string(MAP_WIDTH + 2, '-') << "\n";
-    
-    ss << "Legend: S=Squirrel, W=Werewolf, D=Druid\n";
+}
+
+void GameEngine::commitKills() {
+    TRACE_SCOPE("commit_kills");
+    pendingKills.clear();
+    for (auto& hits : lethalHits) {
+        pendingKills.insert(pendingKills.end(), hits.begin(), hits.end());
+        hits.clear();
+    }
+    // Жертву нескольких нападающих убивает нападающий с меньшим id.
+    std::sort(pendingKills.begin(), pendingKills.end(), [](const BattleEvent& l, const BattleEvent& r) {
+        return l.defenderId != r.defenderId ? l.defenderId < r.defenderId : l.attackerId < r.attackerId;
+    });
+    for (auto& event : pendingKills) {
+        event.killed = world.kill(event.defenderId);
+        event.targetAlreadyDead = !event.killed;
+        if (event.killed && event.defenderId < npcs.size()) {
+            npcs[event.defenderId]->setAlive(false);
+        }
+        battleLogger.logBattleEvent(event);
+    }
+    if (eventLog.isOpen()) {
+        for (auto& battles : loggedBattles) {
+            eventLog.append(battles);
+            battles.clear();
+        }
+        eventLog.append(pendingKills);
+    }
+}
+
+void GameEngine::printMap() {
+    ScopedTimer timer(profiler.histogram(0, ProfilePoint::RENDER));
+    TRACE_SCOPE("render");
+    // Фаза наблюдения идёт в потоке тиков, который сам меняет буферы, —
+    // front можно читать без блокировки.
+    renderer.rasterize(world, world.front());
     
-    int aliveCount = 0;
-    int squirrels = 0, werewolves = 0, druids = 0;
+    std::stringstream header;
+    header << "=== Time: " << elapsedTime << "s (tick " << scheduler.currentTick() << ") ===";
     
-    for (const auto& npc : npcs) {
-        if (npc->isAlive()) {
-            aliveCount++;
-            if (npc->getType() == "Squirrel") squirrels++;
-            else if (npc->getType() == "Werewolf") werewolves++;
-            else if (npc->getType() == "Druid") druids++;
+    std::vector<std::string> footer;
+    std::stringstream ss;
+    if (renderer.getStyle() == MapRenderer::Style::DENSITY) {
+        ss << "Density: \" .:-=+*#%@\" (log scale), peak " << renderer.peakDensity() << " NPCs per cell";
+    } else {
+        ss << "Legend:";
+        for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+            ss << (k ? ", " : " ") << SPECIES[k].mapSymbol << "=" << SPECIES[k].name;
         }
     }
+    footer.push_back(ss.str());
     
-    ss << "Alive: " << aliveCount 
-       << " (S:" << squirrels 
-       << " W:" << werewolves 
-       << " D:" << druids << ")\n";
+    auto aliveByKind = getAliveByKind();
+    ss.str("");
+    ss << "Alive: " << world.aliveCount() << " (";
+    for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+        ss << (k ? " " : "") << SPECIES[k].mapSymbol << ":" << aliveByKind[k];
+    }
+    ss << "), kills: " << battleStats.killCount();
+    footer.push_back(ss.str());
     
-    ss << "Battle queue: " << battleQueue.size() << " tasks\n";
+    ss.str("");
+    ss << "Battle queue: " << battleQueue.size() << " tasks"
+       << " (coalesced: " << battleQueue.coalescedCount()
+       << ", stale dropped: " << battleQueue.staleDroppedCount() << ")";
+    footer.push_back(ss.str());
     
-    safePrint(ss.str());
+    auto tickStats = scheduler.getStats();
+    ss.str("");
+    ss << std::fixed << std::setprecision(2)
+       << "Tick: last " << tickStats.lastTickMs << " ms, avg " << tickStats.avgTickMs
+       << " ms, max " << tickStats.maxTickMs << " ms, budget " << tickStats.budgetMs
+       << " ms, overruns " << tickStats.overruns;
+    footer.push_back(ss.str());
+    
+    std::string frame = renderer.present(header.str(), footer);
+    std::lock_guard<ConsoleMutex> lock(coutMutex);
+    std::cout << frame << std::flush;
 }
 
 void GameEngine::printSurvivors() const {
     std::stringstream ss;
     ss << "\n=== GAME OVER ===\n";
-    ss << "Total time: " << elapsedTime << " seconds\n";
+    ss << "Total time: " << elapsedTime << " seconds (" << scheduler.currentTick() << " ticks)\n";
     
-    std::vector<std::shared_ptr<NPC>> survivors;
-    int totalSquirrels = 0, totalWerewolves = 0, totalDruids = 0;
+    auto aliveByKind = getAliveByKind();
+    ss << "\n=== SURVIVORS ===\n";
+    ss << "Total survivors: " << world.aliveCount() << "\n";
+    ss << "Squirrels: " << aliveByKind[static_cast<size_t>(NPCKind::SQUIRREL)] << "\n";
+    ss << "Werewolves: " << aliveByKind[static_cast<size_t>(NPCKind::WEREWOLF)] << "\n";
+    ss << "Druids: " << aliveByKind[static_cast<size_t>(NPCKind::DRUID)] << "\n";
     
+    std::vector<std::shared_ptr<NPC>> survivors;
     for (const auto& npc : npcs) {
         if (npc->isAlive()) {
             survivors.push_back(npc);
-            if (npc->getType() == "Squirrel") totalSquirrels++;
-            else if (npc->getType() == "Werewolf") totalWerewolves++;
-            else if (npc->getType() == "Druid") totalDruids++;
         }
     }
-    
-    ss << "\n=== SURVIVORS ===\n";
-    ss << "Total survivors: " << survivors.size() << "\n";
-    ss << "Squirrels: " << totalSquirrels << "\n";
-    ss << "Werewolves: " << totalWerewolves << "\n";
-    ss << "Druids: " << totalDruids << "\n";
-    
     if (!survivors.empty()) {
         ss << "\nSurvivor list:\n";
         ss << std::left << std::setw(20) << "Name" 
@@ -251,11 +699,73 @@ void GameEngine::printSurvivors() const {
         
         for (const auto& npc : survivors) {
             ss << std::left << std::setw(20) << npc->getName()
-               << std::setw(15) << npc->getType()
+               << std::setw(15) << speciesTraits(npc->getKind()).name
                << std::setw(10) << std::fixed << std::setprecision(1) << npc->getX()
                << std::setw(10) << npc->getY() << "\n";
         }
     }
+    if (lockstats::ENABLED) {
+        ss << "\n=== LOCK CONTENTION ===\n" << lockstats::toText(lockUsage);
+    }
     
     safePrint(ss.str());
-}
\ No newline at end of file
+}
+
+std::array<size_t, NPC_KIND_COUNT> GameEngine::getAliveByKind() const {
+    std::array<size_t, NPC_KIND_COUNT> result{};
+    for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+        result[k] = world.aliveCount(static_cast<NPCKind>(k));
+    }
+    return result;
+}
+
+void GameEngine::printSummary() const {
+    auto aliveByKind = getAliveByKind();
+    size_t aliveCount = world.aliveCount();
+    
+    auto tickStats = scheduler.getStats();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"npcs\":" << world.size()
+       << ",\"ticks\":" << scheduler.currentTick()
+       << ",\"seed\":" << seed
+       << ",\"threads\":" << battleWorkerCount
+       << ",\"phase_threads\":" << phaseRunner.threadCount()
+       << ",\"map\":[" << config.mapMinX << "," << config.mapMaxX << "," << config.mapMinY << "," << config.mapMaxY << "]"
+       << ",\"alive\":" << aliveCount
+       << ",\"alive_by_species\":{";
+    for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+        ss << (k ? "," : "") << "\"" << SPECIES[k].name << "\":" << aliveByKind[k];
+    }
+    ss << "},\"kills\":" << battleStats.killCount()
+       << ",\"coalesced\":" << battleQueue.coalescedCount()
+       << ",\"stale_dropped\":" << battleQueue.staleDroppedCount()
+       << ",\"log_dropped\":" << (fileLogger ? fileLogger->droppedCount() : 0)
+       << ",\"wall_ms\":" << wallTimeMs
+       << ",\"tick_ms\":{\"avg\":" << tickStats.avgTickMs << ",\"max\":" << tickStats.maxTickMs << "}"
+       << ",\"overruns\":" << tickStats.overruns
+       << ",\"profile\":" << TickProfiler::toJson(profiler.stats());
+    if (lockstats::ENABLED) {
+        ss << ",\"locks\":" << lockstats::toJson(lockUsage);
+    }
+    ss << "}\n";
+    
+    std::lock_guard<ConsoleMutex> lock(coutMutex);
+    std::cout << ss.str() << std::flush;
+}
+
+void GameEngine::dumpProfile(uint64_t tick) {
+    TickProfiler::Snapshot current = profiler.snapshot();
+    TickProfiler::Snapshot window;
+    for (size_t p = 0; p < PROFILE_POINT_COUNT; p++) {
+        window[p] = current[p].since(lastProfile[p]);
+    }
+    lastProfile = std::move(current);
+    
+    std::stringstream ss;
+    ss << "{\"tick\":" << tick
+       << ",\"overruns\":" << scheduler.getStats().overruns
+       << ",\"profile\":" << TickProfiler::toJson(TickProfiler::summarize(window)) << "}\n";
+    std::lock_guard<ConsoleMutex> lock(coutMutex);
+    std::cerr << ss.str() << std::flush;
+}
@@ -0,0 +1,66 @@
+#include "../include/lock_stats.h"
+#include <iomanip>
+#include <sstream>
+
+const char* lockClassName(LockClass lockClass) {
+    switch (lockClass) {
+        case LockClass::NPC: return "npc";
+        case LockClass::QUEUE_SHARD: return "queue_shard";
+        case LockClass::QUEUE_WAIT: return "queue_wait";
+        case LockClass::CONSOLE: return "console";
+        default: return "unknown";
+    }
+}
+
+namespace lockstats {
+
+Snapshot snapshot() {
+    Snapshot result;
+    for (size_t i = 0; i < LOCK_CLASS_COUNT; i++) {
+        result[i].acquisitions = counters[i].acquisitions.load(std::memory_order_relaxed);
+        result[i].contended = counters[i].contended.load(std::memory_order_relaxed);
+        result[i].waitNs = counters[i].waitNs.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+Snapshot since(const Snapshot& now, const Snapshot& earlier) {
+    Snapshot result;
+    for (size_t i = 0; i < LOCK_CLASS_COUNT; i++) {
+        result[i].acquisitions = now[i].acquisitions - earlier[i].acquisitions;
+        result[i].contended = now[i].contended - earlier[i].contended;
+        result[i].waitNs = now[i].waitNs - earlier[i].waitNs;
+    }
+    return result;
+}
+
+std::string toJson(const Snapshot& stats) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "{";
+    for (size_t i = 0; i < LOCK_CLASS_COUNT; i++) {
+        ss << (i ? "," : "") << "\"" << lockClassName(static_cast<LockClass>(i)) << "\":{"
+           << "\"acquired\":" << stats[i].acquisitions
+           << ",\"contended\":" << stats[i].contended
+           << ",\"wait_ms\":" << stats[i].waitNs / 1e6 << "}";
+    }
+    ss << "}";
+    return ss.str();
+}
+
+std::string toText(const Snapshot& stats) {
+    std::stringstream ss;
+    ss << std::left << std::setw(14) << "Lock" << std::right << std::setw(14) << "acquired"
+       << std::setw(12) << "contended" << std::setw(10) << "rate" << std::setw(12) << "wait ms" << "\n";
+    ss << std::fixed;
+    for (size_t i = 0; i < LOCK_CLASS_COUNT; i++) {
+        const auto& s = stats[i];
+        double rate = s.acquisitions ? 100.0 * s.contended / s.acquisitions : 0.0;
+        ss << std::left << std::setw(14) << lockClassName(static_cast<LockClass>(i)) << std::right
+           << std::setw(14) << s.acquisitions << std::setw(12) << s.contended
+           << std::setw(9) << std::setprecision(2) << rate << "%"
+           << std::setw(12) << std::setprecision(3) << s.waitNs / 1e6 << "\n";
+    }
+    return ss.str();
+}
+
+}
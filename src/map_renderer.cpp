@@ -0,0 +1,234 @@
+#include "../include/map_renderer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr char EMPTY_CELL = '.';
+constexpr size_t MAP_FIRST_ROW = 3;
+constexpr char DENSITY_LEVELS[] = " .:-=+*#%@";
+constexpr size_t DENSITY_LEVEL_COUNT = sizeof(DENSITY_LEVELS) - 1;
+// Цвет клетки — ANSI-код преобладающего вида (0 — без цвета).
+constexpr std::array<uint8_t, 8> SPECIES_COLORS = {32, 31, 34, 33, 35, 36, 37, 90};
+constexpr size_t MIN_NPCS_PER_BIN_THREAD = 1 << 16;
+
+void moveCursor(std::string& out, size_t row, size_t col) {
+    out += "\x1b[";
+    out += std::to_string(row);
+    out += ';';
+    out += std::to_string(col);
+    out += 'H';
+}
+
+}
+
+MapRenderer::MapRenderer(Mode mode, const Viewport& view)
+    : mode(mode), viewport(view) {
+    viewport.width = std::max<size_t>(1, viewport.width);
+    viewport.height = std::max<size_t>(1, viewport.height);
+    viewport.zoom = std::max(1.0, viewport.zoom);
+    size_t cells = viewport.width * viewport.height;
+    frontFrame.assign(cells, EMPTY_CELL);
+    backFrame.assign(cells, EMPTY_CELL);
+    frontColors.assign(cells, 0);
+    backColors.assign(cells, 0);
+    bins.assign(cells, Bin{});
+}
+
+void MapRenderer::setBounds(double minX, double maxX, double minY, double maxY) {
+    viewWidth = (maxX - minX) / viewport.zoom;
+    viewHeight = (maxY - minY) / viewport.zoom;
+    double cx = std::isnan(viewport.centerX) ? (minX + maxX) / 2 : viewport.centerX;
+    double cy = std::isnan(viewport.centerY) ? (minY + maxY) / 2 : viewport.centerY;
+    viewMinX = std::clamp(cx - viewWidth / 2, minX, maxX - viewWidth);
+    viewMinY = std::clamp(cy - viewHeight / 2, minY, maxY - viewHeight);
+    needFullRedraw = true;
+}
+
+bool MapRenderer::cellPosition(double x, double y, size_t& cell) const {
+    double col = (x - viewMinX) * (viewport.width / viewWidth);
+    double row = (y - viewMinY) * (viewport.height / viewHeight);
+    if (col < 0.0 || row < 0.0 || col > viewport.width || row > viewport.height) return false;
+    // Правая и нижняя границы окна попадают в последнюю клетку.
+    size_t c = std::min(static_cast<size_t>(col), viewport.width - 1);
+    size_t r = std::min(static_cast<size_t>(row), viewport.height - 1);
+    cell = r * viewport.width + c;
+    return true;
+}
+
+void MapRenderer::rasterize(const NpcWorld& world, const NpcWorld::Positions& positions) {
+    std::fill(backColors.begin(), backColors.end(), 0);
+    if (style == Style::DENSITY) {
+        rasterizeDensity(world, positions);
+    } else {
+        rasterizeSymbols(world, positions);
+    }
+}
+
+void MapRenderer::rasterizeSymbols(const NpcWorld& world, const NpcWorld::Positions& positions) {
+    std::fill(backFrame.begin(), backFrame.end(), EMPTY_CELL);
+    size_t cell;
+    for (size_t i = 0; i < world.size(); i++) {
+        if (world.isAlive(i) && cellPosition(positions.x[i], positions.y[i], cell)) {
+            backFrame[cell] = world.traitsAt(i).mapSymbol;
+        }
+    }
+}
+
+void MapRenderer::rasterizeDensity(const NpcWorld& world, const NpcWorld::Positions& positions) {
+    size_t count = world.size();
+    size_t threads = runner ? runner->threadCount() : 1;
+    size_t chunks = std::max<size_t>(1, std::min(threads, count / MIN_NPCS_PER_BIN_THREAD));
+    
+    // Каждый кусок считает свой диапазон NPC в собственные корзины, потом суммируем.
+    if (partialBins.size() < chunks) partialBins.resize(chunks);
+    auto binRange = [&](size_t chunk) {
+        auto& local = partialBins[chunk];
+        local.assign(bins.size(), Bin{});
+        size_t begin = count * chunk / chunks;
+        size_t end = count * (chunk + 1) / chunks;
+        size_t cell;
+        for (size_t i = begin; i < end; i++) {
+            if (world.isAlive(i) && cellPosition(positions.x[i], positions.y[i], cell)) {
+                local[cell][static_cast<size_t>(world.kind(i))]++;
+            }
+        }
+    };
+    if (runner && chunks > 1) {
+        runner->run(chunks, binRange);
+    } else {
+        binRange(0);
+    }
+    
+    bins.swap(partialBins[0]);
+    for (size_t w = 1; w < chunks; w++) {
+        for (size_t c = 0; c < bins.size(); c++) {
+            for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+                bins[c][k] += partialBins[w][c][k];
+            }
+        }
+    }
+    
+    peak = 0;
+    totals.assign(bins.size(), 0);
+    for (size_t c = 0; c < bins.size(); c++) {
+        for (uint32_t n : bins[c]) totals[c] += n;
+        peak = std::max(peak, totals[c]);
+    }
+    
+    double scale = std::log1p(static_cast<double>(peak));
+    for (size_t c = 0; c < bins.size(); c++) {
+        if (totals[c] == 0) {
+            backFrame[c] = DENSITY_LEVELS[0];
+            continue;
+        }
+        double t = std::log1p(static_cast<double>(totals[c])) / scale;
+        size_t level = 1 + std::min(DENSITY_LEVEL_COUNT - 2, static_cast<size_t>(t * (DENSITY_LEVEL_COUNT - 1)));
+        backFrame[c] = DENSITY_LEVELS[level];
+        
+        size_t dominant = static_cast<size_t>(std::max_element(bins[c].begin(), bins[c].end()) - bins[c].begin());
+        backColors[c] = SPECIES_COLORS[dominant % SPECIES_COLORS.size()];
+    }
+}
+
+void MapRenderer::appendRow(std::string& out, size_t row, size_t begin, size_t end) const {
+    const char* symbols = backFrame.data() + row * viewport.width;
+    const uint8_t* colors = backColors.data() + row * viewport.width;
+    if (mode != Mode::ANSI) {
+        out.append(symbols + begin, end - begin);
+        return;
+    }
+    uint8_t current = 0;
+    for (size_t c = begin; c < end; c++) {
+        if (colors[c] != current) {
+            current = colors[c];
+            out += current ? "\x1b[" + std::to_string(current) + "m" : std::string("\x1b[0m");
+        }
+        out += symbols[c];
+    }
+    if (current) out += "\x1b[0m";
+}
+
+std::string MapRenderer::present(const std::string& header, const std::vector<std::string>& footer) {
+    lastChanged = 0;
+    for (size_t i = 0; i < frontFrame.size(); i++) {
+        if (frontFrame[i] != backFrame[i] || frontColors[i] != backColors[i]) lastChanged++;
+    }
+    std::string out = mode == Mode::ANSI ? presentAnsi(header, footer) : presentText(header, footer);
+    frontFrame.swap(backFrame);
+    frontColors.swap(backColors);
+    frontLines.clear();
+    frontLines.push_back(header);
+    frontLines.insert(frontLines.end(), footer.begin(), footer.end());
+    needFullRedraw = false;
+    return out;
+}
+
+std::string MapRenderer::presentText(const std::string& header, const std::vector<std::string>& footer) {
+    std::string border(viewport.width + 2, '-');
+    std::string out;
+    out.reserve((viewport.width + 3) * (viewport.height + 2) + 256);
+    out += "\n" + header + "\n" + border + "\n";
+    for (size_t r = 0; r < viewport.height; r++) {
+        out += '|';
+        appendRow(out, r, 0, viewport.width);
+        out += "|\n";
+    }
+    out += border + "\n";
+    for (const auto& line : footer) {
+        out += line + "\n";
+    }
+    return out;
+}
+
+std::string MapRenderer::presentAnsi(const std::string& header, const std::vector<std::string>& footer) {
+    size_t footerRow = MAP_FIRST_ROW + viewport.height + 1;
+    std::string out;
+
+    if (needFullRedraw || frontLines.size() != footer.size() + 1) {
+        std::string border(viewport.width + 2, '-');
+        out += "\x1b[H\x1b[2J";
+        out += header + "\r\n" + border + "\r\n";
+        for (size_t r = 0; r < viewport.height; r++) {
+            out += '|';
+            appendRow(out, r, 0, viewport.width);
+            out += "|\r\n";
+        }
+        out += border + "\r\n";
+        for (const auto& line : footer) {
+            out += line + "\x1b[K\r\n";
+        }
+        return out;
+    }
+
+    if (frontLines[0] != header) {
+        moveCursor(out, 1, 1);
+        out += header + "\x1b[K";
+    }
+    // Соседние изменившиеся клетки строки выводятся одним прогоном.
+    for (size_t r = 0; r < viewport.height; r++) {
+        size_t base = r * viewport.width;
+        auto changed = [&](size_t c) {
+            return frontFrame[base + c] != backFrame[base + c] || frontColors[base + c] != backColors[base + c];
+        };
+        size_t c = 0;
+        while (c < viewport.width) {
+            if (!changed(c)) {
+                c++;
+                continue;
+            }
+            size_t start = c;
+            while (c < viewport.width && changed(c)) c++;
+            moveCursor(out, MAP_FIRST_ROW + r, 2 + start);
+            appendRow(out, r, start, c);
+        }
+    }
+    for (size_t i = 0; i < footer.size(); i++) {
+        if (frontLines[i + 1] != footer[i]) {
+            moveCursor(out, footerRow + i, 1);
+            out += footer[i] + "\x1b[K";
+        }
+    }
+    moveCursor(out, footerRow + footer.size(), 1);
+    return out;
+}
@@ -2,25 +2,22 @@
 #include "../include/visitor.h"
 #include <cmath>
 #include <iostream>
-#include <random>
-#include <chrono>
 
-std::mt19937 NPC::rng(std::chrono::steady_clock::now().time_since_epoch().count());
-std::uniform_int_distribution<int> NPC::dice(1, 6);
-
-NPC::NPC(const std::string& name, double x, double y) 
-    : name(name), x(x), y(y), alive(true) {}
+NPC::NPC(NPCKind kind, const std::string& name, double x, double y) 
+    : kind(kind), name(name), x(x), y(y), alive(true) {}
 
 std::string NPC::getName() const {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     return name;
 }
 
 std::string NPC::getType() const {
-    if (dynamic_cast<const Squirrel*>(this)) return "Squirrel";
-    if (dynamic_cast<const Werewolf*>(this)) return "Werewolf";
-    if (dynamic_cast<const Druid*>(this)) return "Druid";
-    return "Unknown";
+    return speciesTraits(kind).name;
+}
+
+bool NPC::canAttack(const NPC* other) const {
+    if (!other || !kindCanAttack(kind, other->kind)) return false;
+    return other->isAlive();
 }
 
 bool NPC::isValidCoordinates(double x, double y) {
@@ -28,41 +25,46 @@ bool NPC::isValidCoordinates(double x, double y) {
 }
 
 double NPC::getX() const {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     return x;
 }
 
 double NPC::getY() const {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     return y;
 }
 
 bool NPC::isAlive() const {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     return alive;
 }
 
+NPC::State NPC::getState() const {
+    std::lock_guard<NpcMutex> lock(mtx);
+    return State{name, x, y, alive};
+}
+
 void NPC::setPosition(double newX, double newY) {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     x = newX;
     y = newY;
 }
 
 void NPC::setAlive(bool status) {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     alive = status;
 }
 
-std::unique_lock<std::mutex> NPC::getLock() const {
-    return std::unique_lock<std::mutex>(const_cast<std::mutex&>(mtx));
+std::unique_lock<NpcMutex> NPC::getLock() const {
+    return std::unique_lock<NpcMutex>(mtx);
 }
 
 double NPC::calculateDistance(const NPC* other) const {
     if (!other || !other->isAlive()) return 999999.0;
     if (other == this) return 0.0;
     
-    std::unique_lock<std::mutex> lock1(mtx, std::defer_lock);
-    std::unique_lock<std::mutex> lock2(other->mtx, std::defer_lock);
+    std::unique_lock<NpcMutex> lock1(mtx, std::defer_lock);
+    std::unique_lock<NpcMutex> lock2(other->mtx, std::defer_lock);
     
     std::lock(lock1, lock2);
     
@@ -71,18 +73,36 @@ double NPC::calculateDistance(const NPC* other) const {
     return std::sqrt(dx * dx + dy * dy);
 }
 
+double NPC::calculateDistanceSquared(const NPC* other) const {
+    if (!other || !other->isAlive()) return 999999.0 * 999999.0;
+    if (other == this) return 0.0;
+    
+    std::unique_lock<NpcMutex> lock1(mtx, std::defer_lock);
+    std::unique_lock<NpcMutex> lock2(other->mtx, std::defer_lock);
+    
+    std::lock(lock1, lock2);
+    
+    double dx = x - other->x;
+    double dy = y - other->y;
+    return dx * dx + dy * dy;
+}
+
 int NPC::rollDice() {
-    return dice(rng);
+    return RngService::threadStream().rollDice();
+}
+
+int NPC::rollDice(RngStream& rng) {
+    return rng.rollDice();
 }
 
 void NPC::move(double minX, double maxX, double minY, double maxY) {
     if (!isAlive()) return;
     
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<NpcMutex> lock(mtx);
     
-    std::uniform_real_distribution<double> dirDist(-1.0, 1.0);
-    double dirX = dirDist(rng);
-    double dirY = dirDist(rng);
+    RngStream& rng = RngService::threadStream();
+    double dirX = rng.uniform(-1.0, 1.0);
+    double dirY = rng.uniform(-1.0, 1.0);
     
     double length = std::sqrt(dirX * dirX + dirY * dirY);
     if (length > 0) {
@@ -104,24 +124,18 @@ void NPC::move(double minX, double maxX, double minY, double maxY) {
 }
 
 Squirrel::Squirrel(const std::string& name, double x, double y) 
-    : NPC(name, x, y) {}
+    : NPC(KIND, name, x, y) {}
 
 void Squirrel::accept(NPCVisitor& visitor) {
     visitor.visit(this);
 }
 
-bool Squirrel::canAttack(const NPC* other) const {
-    if (!other || !other->isAlive()) return false;
-    std::string type = other->getType();
-    return (type == "Werewolf" || type == "Druid");
-}
-
 double Squirrel::getMoveDistance() const {
-    return 5.0;
+    return MOVE_DISTANCE;
 }
 
 double Squirrel::getAttackDistance() const {
-    return 5.0;
+    return ATTACK_DISTANCE;
 }
 
 bool Squirrel::tryAttack(NPC* other) {
@@ -134,27 +148,22 @@ bool Squirrel::tryAttack(NPC* other) {
 }
 
 char Squirrel::getMapSymbol() const {
-    return 'S';
+    return SYMBOL;
 }
 
 Werewolf::Werewolf(const std::string& name, double x, double y) 
-    : NPC(name, x, y) {}
+    : NPC(KIND, name, x, y) {}
 
 void Werewolf::accept(NPCVisitor& visitor) {
     visitor.visit(this);
 }
 
-bool Werewolf::canAttack(const NPC* other) const {
-    if (!other || !other->isAlive()) return false;
-    return other->getType() == "Druid";
-}
-
 double Werewolf::getMoveDistance() const {
-    return 40.0;
+    return MOVE_DISTANCE;
 }
 
 double Werewolf::getAttackDistance() const {
-    return 5.0;
+    return ATTACK_DISTANCE;
 }
 
 bool Werewolf::tryAttack(NPC* other) {
@@ -167,26 +176,22 @@ bool Werewolf::tryAttack(NPC* other) {
 }
 
 char Werewolf::getMapSymbol() const {
-    return 'W';
+    return SYMBOL;
 }
 
 Druid::Druid(const std::string& name, double x, double y) 
-    : NPC(name, x, y) {}
+    : NPC(KIND, name, x, y) {}
 
 void Druid::accept(NPCVisitor& visitor) {
     visitor.visit(this);
 }
 
-bool Druid::canAttack(const NPC* other) const {
-    return false;
-}
-
 double Druid::getMoveDistance() const {
-    return 10.0;
+    return MOVE_DISTANCE;
 }
 
 double Druid::getAttackDistance() const {
-    return 10.0;
+    return ATTACK_DISTANCE;
 }
 
 bool Druid::tryAttack(NPC* other) {
@@ -194,5 +199,5 @@ bool Druid::tryAttack(NPC* other) {
 }
 
 char Druid::getMapSymbol() const {
-    return 'D';
+    return SYMBOL;
 }
\ No newline at end of file
@@ -1,13 +1,152 @@
 #include "../include/npc_factory.h"
+#include "../include/snapshot.h"
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+class MappedFile {
+private:
+    int fd = -1;
+    const char* data = nullptr;
+    size_t length = 0;
+    
+public:
+    explicit MappedFile(const std::string& filename) {
+        fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length == 0) return;
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            fd = -1;
+            length = 0;
+            return;
+        }
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+    }
+    
+    ~MappedFile() {
+        if (data) ::munmap(const_cast<char*>(data), length);
+        if (fd >= 0) ::close(fd);
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool isOpen() const { return fd >= 0; }
+    std::string_view view() const { return std::string_view(data, length); }
+};
+
+struct ParsedChunk {
+    std::vector<NPCKind> kinds;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<std::string_view> names;
+    size_t lines = 0;
+    size_t badLines = 0;
+    std::vector<size_t> badLocalLines;
+};
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+bool parseKind(std::string_view text, NPCKind& kind) {
+    if (text == "SQUIRREL") kind = NPCKind::SQUIRREL;
+    else if (text == "WEREWOLF") kind = NPCKind::WEREWOLF;
+    else if (text == "DRUID") kind = NPCKind::DRUID;
+    else return false;
+    return true;
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    text = trim(text);
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
+
+bool parseLine(std::string_view line, const NPCFactory::LoadOptions& options, ParsedChunk& out) {
+    size_t first = line.find(',');
+    if (first == std::string_view::npos) return false;
+    size_t second = line.find(',', first + 1);
+    if (second == std::string_view::npos) return false;
+    size_t third = line.find(',', second + 1);
+    if (third == std::string_view::npos) return false;
+    
+    NPCKind kind;
+    double x, y;
+    if (!parseKind(trim(line.substr(0, first)), kind) ||
+        !parseDouble(line.substr(second + 1, third - second - 1), x) ||
+        !parseDouble(line.substr(third + 1), y)) {
+        return false;
+    }
+    if (!(x > options.minX && x <= options.maxX && y > options.minY && y <= options.maxY)) {
+        return false;
+    }
+    
+    out.kinds.push_back(kind);
+    out.xs.push_back(x);
+    out.ys.push_back(y);
+    out.names.push_back(line.substr(first + 1, second - first - 1));
+    return true;
+}
+
+void parseChunk(std::string_view text, const NPCFactory::LoadOptions& options, ParsedChunk& out) {
+    // Средняя строка сохранения — около 25 байт.
+    out.kinds.reserve(text.size() / 24);
+    out.xs.reserve(text.size() / 24);
+    out.ys.reserve(text.size() / 24);
+    out.names.reserve(text.size() / 24);
+    
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        
+        size_t lineIndex = out.lines++;
+        if (trim(line).empty()) continue;
+        if (!parseLine(line, options, out)) {
+            out.badLines++;
+            if (out.badLocalLines.size() < NPCFactory::LoadReport::MAX_REPORTED_LINES) {
+                out.badLocalLines.push_back(lineIndex);
+            }
+        }
+    }
+}
+
+}
 
 std::shared_ptr<NPC> NPCFactory::createNPC(NPCType type, const std::string& name, double x, double y){
     if (!NPC::isValidCoordinates(x, y)) {
         std::cerr << "Error: Coordinates must be in range (0 < x <= 500, 0 < y <= 500)" << std::endl;
         return nullptr;
     }
+    return construct(type, name, x, y);
+}
+std::shared_ptr<NPC> NPCFactory::construct(NPCType type, const std::string& name, double x, double y){
     switch (type){
         case NPCType::SQUIRREL:
             return std::make_shared<Squirrel>(name, x, y);
@@ -25,40 +164,140 @@ bool NPCFactory::saveToFile(const std::vector<std::shared_ptr<NPC>>& npcs, const
         std::cerr << "Error: Cannot open file " << filename << " for writing" << std::endl;
         return false;
     }
+    size_t written = 0;
     for (const auto& npc : npcs){
         if (npc->isAlive()) {
-            file << typeToString(stringToType(npc->getType())) << ","
+            file << typeToString(npc->getKind()) << ","
                  << npc->getName() << ","
                  << npc->getX() << ","
                  << npc->getY() << "\n";
+            written++;
         }
     }
     file.close();
-    std::cout << "Saved " << npcs.size() << " NPCs to " << filename << std::endl;
+    std::cout << "Saved " << written << " NPCs to " << filename << std::endl;
     return true;
 }
 std::vector<std::shared_ptr<NPC>> NPCFactory::loadFromFile(const std::string& filename){
     std::vector<std::shared_ptr<NPC>> loadedNPCs;
-    std::ifstream file(filename);
-    if (!file.is_open()){
-        std::cerr << "Error: Cannot open file " << filename << " for reading" << std::endl;
+    NpcWorld world;
+    LoadReport report;
+    if (!loadIntoWorld(filename, world, LoadOptions(), &report)) {
         return loadedNPCs;
     }
-    std::string line;
-    while (std::getline(file, line)){
-        std::stringstream ss(line);
-        std::string typeStr, name;
-        double x, y;
-        if (std::getline(ss, typeStr, ',') && std::getline(ss, name, ',') && (ss >> x) && ss.ignore() && (ss >> y)) {
-            NPCType type = stringToType(typeStr);
-            auto npc = createNPC(type, name, x, y);
-            if (npc){
-                loadedNPCs.push_back(npc);
+    const auto& positions = world.front();
+    loadedNPCs.reserve(world.size());
+    for (size_t i = 0; i < world.size(); i++) {
+        loadedNPCs.push_back(construct(world.kind(i), world.name(i), positions.x[i], positions.y[i]));
+    }
+    if (report.badLines > 0) {
+        std::cerr << "Warning: skipped " << report.badLines << " invalid lines in " << filename
+                  << " (first at line " << report.badLineNumbers.front() << ")" << std::endl;
+    }
+    std::cout << "Loaded " << loadedNPCs.size() << " NPCs from " << filename << std::endl;
+    return loadedNPCs;
+}
+bool NPCFactory::loadIntoWorld(const std::string& filename, NpcWorld& world,
+                               const LoadOptions& options, LoadReport* report){
+    MappedFile file(filename);
+    if (!file.isOpen()){
+        std::cerr << "Error: Cannot open file " << filename << " for reading" << std::endl;
+        return false;
+    }
+    std::string_view text = file.view();
+    
+    size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, text.size() / MIN_CHUNK_BYTES));
+    
+    // Куски режутся по границам строк.
+    std::vector<size_t> bounds{0};
+    for (size_t k = 1; k < threads; k++) {
+        size_t cut = std::max(bounds.back(), text.size() * k / threads);
+        size_t newline = text.find('\n', cut);
+        bounds.push_back(newline == std::string_view::npos ? text.size() : newline + 1);
+    }
+    bounds.push_back(text.size());
+    
+    std::vector<ParsedChunk> chunks(threads);
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < threads; k++) {
+        workers.emplace_back(parseChunk, text.substr(bounds[k], bounds[k + 1] - bounds[k]),
+                             std::cref(options), std::ref(chunks[k]));
+    }
+    parseChunk(text.substr(bounds[0], bounds[1] - bounds[0]), options, chunks[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.kinds.size();
+    world.reserve(world.size() + total);
+    
+    LoadReport local;
+    size_t lineBase = 0;
+    for (const auto& chunk : chunks) {
+        world.append(chunk.kinds, chunk.xs, chunk.ys, chunk.names);
+        local.loaded += chunk.kinds.size();
+        local.badLines += chunk.badLines;
+        for (size_t line : chunk.badLocalLines) {
+            if (local.badLineNumbers.size() < LoadReport::MAX_REPORTED_LINES) {
+                local.badLineNumbers.push_back(lineBase + line + 1);
             }
         }
+        lineBase += chunk.lines;
+    }
+    if (report) *report = std::move(local);
+    return true;
+}
+bool NPCFactory::saveSnapshot(const NpcWorld& world, const std::string& filename){
+    std::vector<uint8_t> buffer;
+    snapshot::encodeWorld(world, buffer);
+    
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()){
+        std::cerr << "Error: Cannot open file " << filename << " for writing" << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    if (!file) {
+        std::cerr << "Error: Failed to write snapshot " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+bool NPCFactory::saveSnapshot(const std::vector<std::shared_ptr<NPC>>& npcs, const std::string& filename){
+    NpcWorld world;
+    world.addFrom(npcs);
+    return saveSnapshot(world, filename);
+}
+bool NPCFactory::loadSnapshot(const std::string& filename, NpcWorld& world){
+    MappedFile file(filename);
+    if (!file.isOpen()){
+        std::cerr << "Error: Cannot open file " << filename << " for reading" << std::endl;
+        return false;
+    }
+    std::string_view text = file.view();
+    std::string error;
+    if (!snapshot::decodeWorld(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size()),
+                               world, error)) {
+        std::cerr << "Error: " << filename << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+std::vector<std::shared_ptr<NPC>> NPCFactory::loadSnapshot(const std::string& filename){
+    std::vector<std::shared_ptr<NPC>> loadedNPCs;
+    NpcWorld world;
+    if (!loadSnapshot(filename, world)) {
+        return loadedNPCs;
+    }
+    const auto& positions = world.front();
+    loadedNPCs.reserve(world.size());
+    for (size_t i = 0; i < world.size(); i++) {
+        auto npc = construct(world.kind(i), world.name(i), positions.x[i], positions.y[i]);
+        npc->setAlive(world.isAlive(i));
+        loadedNPCs.push_back(npc);
     }
-    file.close();
-    std::cout << "Loaded " << loadedNPCs.size() << " NPCs from " << filename << std::endl;
     return loadedNPCs;
 }
 NPCFactory::NPCType NPCFactory::stringToType(const std::string& typeStr){
@@ -0,0 +1,101 @@
+#include "../include/npc_world.h"
+#include <algorithm>
+
+void NpcWorld::reserve(size_t count) {
+    for (auto& buffer : buffers) {
+        buffer.x.reserve(count);
+        buffer.y.reserve(count);
+    }
+    alive.reserve(count);
+    kinds.reserve(count);
+    nameIndex.reserve(count);
+    names.reserve(count);
+}
+
+size_t NpcWorld::add(Kind kind, const std::string& name, double x, double y) {
+    size_t index = kinds.size();
+    for (auto& buffer : buffers) {
+        buffer.x.push_back(x);
+        buffer.y.push_back(y);
+    }
+    alive.push_back(1);
+    kinds.push_back(static_cast<uint8_t>(kind));
+    nameIndex.push_back(static_cast<uint32_t>(names.size()));
+    names.push_back(name);
+    aliveByKind[static_cast<size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+void NpcWorld::addFrom(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    reserve(size() + npcs.size());
+    for (const auto& npc : npcs) {
+        NPC::State state = npc->getState();
+        size_t index = add(npc->getKind(), state.name, state.x, state.y);
+        if (!state.alive) kill(index);
+    }
+}
+
+void NpcWorld::append(std::span<const Kind> newKinds, std::span<const double> xs, std::span<const double> ys,
+                      std::span<const std::string_view> newNames) {
+    size_t count = newKinds.size();
+    size_t base = names.size();
+    for (auto& buffer : buffers) {
+        buffer.x.insert(buffer.x.end(), xs.begin(), xs.begin() + count);
+        buffer.y.insert(buffer.y.end(), ys.begin(), ys.begin() + count);
+    }
+    alive.insert(alive.end(), count, 1);
+    for (size_t i = 0; i < count; i++) {
+        kinds.push_back(static_cast<uint8_t>(newKinds[i]));
+        nameIndex.push_back(static_cast<uint32_t>(base + i));
+        names.emplace_back(newNames[i]);
+        aliveByKind[static_cast<size_t>(newKinds[i])].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void NpcWorld::syncTo(const std::vector<std::shared_ptr<NPC>>& npcs) const {
+    readFront([&](const Positions& positions) {
+        size_t count = std::min(npcs.size(), size());
+        for (size_t i = 0; i < count; i++) {
+            npcs[i]->setPosition(positions.x[i], positions.y[i]);
+            npcs[i]->setAlive(isAlive(i));
+        }
+    });
+}
+
+void NpcWorld::clear() {
+    std::lock_guard<std::mutex> lock(swapMutex);
+    for (auto& buffer : buffers) {
+        buffer.x.clear();
+        buffer.y.clear();
+    }
+    frontIndex = 0;
+    alive.clear();
+    kinds.clear();
+    nameIndex.clear();
+    names.clear();
+    for (auto& counter : aliveByKind) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+void NpcWorld::swapBuffers() {
+    std::lock_guard<std::mutex> lock(swapMutex);
+    frontIndex ^= 1;
+}
+
+bool NpcWorld::kill(size_t i) {
+    uint8_t expected = 1;
+    if (!std::atomic_ref<uint8_t>(alive[i]).compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return false;
+    }
+    aliveByKind[kinds[i]].fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t NpcWorld::aliveCount() const {
+    size_t total = 0;
+    for (const auto& counter : aliveByKind) {
+        total += counter.load(std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -1,44 +1,202 @@
 #include "../include/observer.h"
+#include "../include/trace.h"
 #include <iostream>
-#include <fstream>
 #include <ctime>
 #include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr size_t EVENT_TEXT_SIZE = 256;
+
+size_t formatStamp(char* out, size_t capacity) {
+    std::time_t now = std::time(nullptr);
+    std::tm timeinfo{};
+    localtime_r(&now, &timeinfo);
+    return std::strftime(out, capacity, "[%Y-%m-%d %H:%M:%S] ", &timeinfo);
+}
 
-void BattleSubject::attach(BattleObserver* observer){
-    observers.push_back(observer);
 }
-void BattleSubject::detach(BattleObserver* observer){
-    auto it = std::find(observers.begin(), observers.end(), observer);
-    if (it != observers.end()) {
-        observers.erase(it);
+
+size_t describeBattle(const BattleEvent& event, char* out, size_t capacity) {
+    const char* attackerType = speciesTraits(event.attackerKind).name;
+    const char* defenderType = speciesTraits(event.defenderKind).name;
+    int written;
+    if (!event.attackerName.empty() && !event.defenderName.empty()) {
+        written = std::snprintf(out, capacity, "%.*s (%s) %s %.*s (%s)",
+                                static_cast<int>(event.attackerName.size()), event.attackerName.data(), attackerType,
+                                event.killed ? "killed" : "failed to kill",
+                                static_cast<int>(event.defenderName.size()), event.defenderName.data(), defenderType);
+    } else {
+        written = std::snprintf(out, capacity, "#%u (%s) %s #%u (%s)",
+                                event.attackerId, attackerType, event.killed ? "killed" : "failed to kill",
+                                event.defenderId, defenderType);
     }
+    if (written < 0) return 0;
+    return std::min(static_cast<size_t>(written), capacity ? capacity - 1 : 0);
+}
+
+std::string describeBattle(const BattleEvent& event) {
+    char buffer[EVENT_TEXT_SIZE];
+    return std::string(buffer, describeBattle(event, buffer, sizeof(buffer)));
+}
+
+BattleSubject::ThreadCache& BattleSubject::threadCache(){
+    thread_local ThreadCache cache;
+    return cache;
+}
+void BattleSubject::publish(std::shared_ptr<const ObserverList> updated){
+    observers.store(std::move(updated));
+    version.fetch_add(1, std::memory_order_release);
+}
+template<typename Fn>
+void BattleSubject::forEachObserver(Fn&& fn){
+    ThreadCache& cache = threadCache();
+    uint64_t current = version.load(std::memory_order_acquire);
+    bool cached = cache.subjectId == subjectId && cache.version == current;
+    // Пока поток внутри notify, кэш не заменяется: иначе вложенный notify
+    // освободил бы список, по которому идёт внешний цикл.
+    if (!cached && cache.depth == 0) {
+        cache.list = observers.load();
+        cache.subjectId = subjectId;
+        cache.version = current;
+        cached = true;
+    }
+    if (!cached) {
+        auto snapshot = observers.load();
+        for (const auto& entry : *snapshot) fn(*entry.observer);
+        return;
+    }
+    const ObserverList& list = *cache.list;
+    cache.depth++;
+    for (const auto& entry : list) fn(*entry.observer);
+    cache.depth--;
+}
+BattleSubject::ObserverId BattleSubject::add(std::shared_ptr<BattleObserver> observer){
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto updated = std::make_shared<ObserverList>(*observers.load());
+    ObserverId id = nextId++;
+    updated->push_back(Entry{id, std::move(observer)});
+    publish(std::move(updated));
+    return id;
+}
+BattleSubject::ObserverId BattleSubject::attach(std::shared_ptr<BattleObserver> observer){
+    return add(std::move(observer));
+}
+BattleSubject::ObserverId BattleSubject::attach(BattleObserver* observer){
+    return add(std::shared_ptr<BattleObserver>(observer, [](BattleObserver*) {}));
+}
+bool BattleSubject::detach(ObserverId id){
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto current = observers.load();
+    auto it = std::find_if(current->begin(), current->end(), [id](const Entry& entry) { return entry.id == id; });
+    if (it == current->end()) return false;
+    auto updated = std::make_shared<ObserverList>(*current);
+    updated->erase(updated->begin() + (it - current->begin()));
+    publish(std::move(updated));
+    return true;
+}
+bool BattleSubject::detach(BattleObserver* observer){
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto current = observers.load();
+    auto it = std::find_if(current->begin(), current->end(),
+                           [observer](const Entry& entry) { return entry.observer.get() == observer; });
+    if (it == current->end()) return false;
+    auto updated = std::make_shared<ObserverList>(*current);
+    updated->erase(updated->begin() + (it - current->begin()));
+    publish(std::move(updated));
+    return true;
+}
+size_t BattleSubject::observerCount() const{
+    return observers.load()->size();
 }
 void BattleSubject::notify(const std::string& event){
-    for (auto observer : observers) {
-        observer->update(event);
+    forEachObserver([&event](BattleObserver& observer) { observer.update(event); });
+}
+void BattleSubject::notify(const BattleEvent& event){
+    forEachObserver([&event](BattleObserver& observer) { observer.onBattle(event); });
+}
+void BattleObserver::onBattle(const BattleEvent& event){
+    if (event.killed) {
+        update(describeBattle(event));
+    }
+}
+void ConsoleLogger::write(const char* text, size_t length){
+    if (consoleLock) {
+        std::lock_guard<ConsoleMutex> lock(*consoleLock);
+        std::cout.write(text, static_cast<std::streamsize>(length));
+    } else {
+        std::cout.write(text, static_cast<std::streamsize>(length));
     }
 }
 void ConsoleLogger::update(const std::string& event){
-    std::time_t now = std::time(nullptr);
-    std::tm* timeinfo = std::localtime(&now);
-    char buffer[80];
-    std::strftime(buffer, sizeof(buffer), "[%Y-%m-%d %H:%M:%S]", timeinfo);
-    
-    std::cout << buffer << " " << event << std::endl;
+    char stamp[32];
+    size_t length = formatStamp(stamp, sizeof(stamp));
+    std::string line = std::string(stamp, length) + event + '\n';
+    write(line.data(), line.size());
+}
+void ConsoleLogger::onBattle(const BattleEvent& event){
+    if (!event.killed) return;
+    // Строка собирается целиком до захвата блокировки консоли.
+    char buffer[EVENT_TEXT_SIZE + 32];
+    size_t length = formatStamp(buffer, sizeof(buffer));
+    length += describeBattle(event, buffer + length, sizeof(buffer) - length - 1);
+    buffer[length++] = '\n';
+    write(buffer, length);
 }
-FileLogger::FileLogger(const std::string& filename) : filename(filename){}
+FileLogger::FileLogger(const std::string& filename)
+    : FileLogger(filename, AsyncLogWriter::Options()) {}
+FileLogger::FileLogger(const std::string& filename, const AsyncLogWriter::Options& options)
+    : filename(filename), writer(std::make_unique<AsyncLogWriter>(filename, options)) {}
 void FileLogger::update(const std::string& event){
-    std::ofstream file(filename, std::ios::app);
-    if (file.is_open()) {
-        std::time_t now = std::time(nullptr);
-        std::tm* timeinfo = std::localtime(&now);
-        char buffer[80];
-        std::strftime(buffer, sizeof(buffer), "[%Y-%m-%d %H:%M:%S]", timeinfo);
-        
-        file << buffer << " " << event << std::endl;
-        file.close();
+    writer->push(event);
+}
+void FileLogger::onBattle(const BattleEvent& event){
+    if (!event.killed) return;
+    char buffer[EVENT_TEXT_SIZE];
+    writer->push(std::string_view(buffer, describeBattle(event, buffer, sizeof(buffer))));
+}
+void FileLogger::flush(){
+    TRACE_SCOPE("log_flush");
+    writer->flush();
+}
+size_t FileLogger::droppedCount() const{
+    return writer->droppedCount();
+}
+void BattleStatsObserver::onBattle(const BattleEvent& event){
+    battles.fetch_add(1, std::memory_order_relaxed);
+    if (!event.killed) return;
+    kills.fetch_add(1, std::memory_order_relaxed);
+    killsBy[static_cast<size_t>(event.attackerKind)].fetch_add(1, std::memory_order_relaxed);
+    lossesOf[static_cast<size_t>(event.defenderKind)].fetch_add(1, std::memory_order_relaxed);
+}
+size_t BattleStatsObserver::killsByKind(NPCKind kind) const{
+    return killsBy[static_cast<size_t>(kind)].load(std::memory_order_relaxed);
+}
+size_t BattleStatsObserver::lossesOfKind(NPCKind kind) const{
+    return lossesOf[static_cast<size_t>(kind)].load(std::memory_order_relaxed);
+}
+BattleStatsObserver::Counters BattleStatsObserver::counters() const{
+    Counters result;
+    result.battles = battles.load();
+    result.kills = kills.load();
+    for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+        result.killsBy[k] = killsBy[k].load();
+        result.lossesOf[k] = lossesOf[k].load();
+    }
+    return result;
+}
+void BattleStatsObserver::restore(const Counters& counters){
+    battles.store(counters.battles);
+    kills.store(counters.kills);
+    for (size_t k = 0; k < NPC_KIND_COUNT; k++) {
+        killsBy[k].store(counters.killsBy[k]);
+        lossesOf[k].store(counters.lossesOf[k]);
     }
 }
 void BattleLogger::logBattleEvent(const std::string& event){
     notify(event);
+}
+void BattleLogger::logBattleEvent(const BattleEvent& event){
+    notify(event);
 }
\ No newline at end of file
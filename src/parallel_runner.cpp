@@ -0,0 +1,88 @@
+#include "../include/parallel_runner.h"
+#include <algorithm>
+
+ParallelRunner::ParallelRunner(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    maxWorkers = threads - 1;
+}
+
+ParallelRunner::~ParallelRunner() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    for (auto& worker : workers) {
+        worker->wakeCv.notify_one();
+    }
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void ParallelRunner::runChunks(const ChunkFn& fn, size_t chunks) {
+    for (size_t chunk = nextChunk.fetch_add(1); chunk < chunks; chunk = nextChunk.fetch_add(1)) {
+        fn(chunk);
+    }
+}
+
+void ParallelRunner::run(size_t chunks, const ChunkFn& fn) {
+    if (chunks == 0) return;
+    size_t helpers = std::min(chunks - 1, maxWorkers);
+    if (helpers == 0) {
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            fn(chunk);
+        }
+        return;
+    }
+    while (workers.size() < helpers) {
+        workers.push_back(std::make_unique<Worker>());
+        Worker& worker = *workers.back();
+        worker.thread = std::thread(&ParallelRunner::workerLoop, this, std::ref(worker));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = &fn;
+        chunkCount = chunks;
+        nextChunk.store(0);
+        finishedWorkers = 0;
+        generation++;
+        for (size_t i = 0; i < helpers; i++) {
+            workers[i]->assigned = generation;
+        }
+    }
+    for (size_t i = 0; i < helpers; i++) {
+        workers[i]->wakeCv.notify_one();
+    }
+    runChunks(fn, chunks);
+
+    // Ждём всех разбуженных, а не только куски: иначе опоздавший поток мог бы
+    // взять номер куска уже следующего запуска со старой функцией.
+    std::unique_lock<std::mutex> lock(mtx);
+    doneCv.wait(lock, [&]() { return finishedWorkers == helpers; });
+    job = nullptr;
+}
+
+void ParallelRunner::workerLoop(Worker& self) {
+    uint64_t seen = 0;
+    while (true) {
+        const ChunkFn* fn;
+        size_t chunks;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            self.wakeCv.wait(lock, [&]() { return stopping || self.assigned != seen; });
+            if (stopping) return;
+            seen = self.assigned;
+            fn = job;
+            chunks = chunkCount;
+        }
+        runChunks(*fn, chunks);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            finishedWorkers++;
+        }
+        doneCv.notify_one();
+    }
+}
@@ -0,0 +1,129 @@
+#include "../include/profiler.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+const char* profilePointName(ProfilePoint point) {
+    switch (point) {
+        case ProfilePoint::MOVE: return "move";
+        case ProfilePoint::DETECT: return "detect";
+        case ProfilePoint::RESOLVE: return "resolve";
+        case ProfilePoint::OBSERVE: return "observe";
+        case ProfilePoint::TICK: return "tick";
+        case ProfilePoint::BATTLE: return "battle";
+        case ProfilePoint::QUEUE_WAIT: return "queue_wait";
+        case ProfilePoint::RENDER: return "render";
+        default: return "unknown";
+    }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+    unsigned shift = static_cast<unsigned>(std::bit_width(ns)) - 1 - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((ns >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+    unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS - 1);
+    uint64_t sub = index % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    // Писатель у гистограммы один, поэтому хватает relaxed load/store без RMW.
+    auto bump = [](std::atomic<uint64_t>& counter, uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    };
+    bump(buckets[bucketIndex(ns)], 1);
+    bump(totalNs, ns);
+    if (ns > maxNs.load(std::memory_order_relaxed)) {
+        maxNs.store(ns, std::memory_order_relaxed);
+    }
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void LatencyHistogram::addTo(Counts& counts) const {
+    counts.count += count.load(std::memory_order_acquire);
+    counts.totalNs += totalNs.load(std::memory_order_relaxed);
+    counts.maxNs = std::max(counts.maxNs, maxNs.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        counts.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::Counts LatencyHistogram::Counts::since(const Counts& earlier) const {
+    Counts window;
+    window.count = count - earlier.count;
+    window.totalNs = totalNs - earlier.totalNs;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        window.buckets[i] = buckets[i] - earlier.buckets[i];
+        // Точный максимум окна не восстановить — берём верх старшей корзины.
+        if (window.buckets[i]) window.maxNs = std::min(bucketValue(i), maxNs);
+    }
+    return window;
+}
+
+uint64_t LatencyHistogram::percentile(const Counts& counts, double quantile) {
+    if (counts.count == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * counts.count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts.buckets[i];
+        if (seen >= rank) return std::min(bucketValue(i), counts.maxNs);
+    }
+    return counts.maxNs;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize(const Counts& counts) {
+    Summary summary;
+    summary.count = counts.count;
+    if (counts.count == 0) return summary;
+    summary.meanUs = counts.totalNs / 1000.0 / counts.count;
+    summary.p50Us = percentile(counts, 0.50) / 1000.0;
+    summary.p99Us = percentile(counts, 0.99) / 1000.0;
+    summary.maxUs = counts.maxNs / 1000.0;
+    return summary;
+}
+
+TickProfiler::TickProfiler(size_t threadCount) {
+    for (size_t i = 0; i < std::max<size_t>(1, threadCount); i++) {
+        threads.push_back(std::make_unique<ThreadHistograms>());
+    }
+}
+
+TickProfiler::Snapshot TickProfiler::snapshot() const {
+    Snapshot merged;
+    for (const auto& thread : threads) {
+        for (size_t p = 0; p < PROFILE_POINT_COUNT; p++) {
+            (*thread)[p].addTo(merged[p]);
+        }
+    }
+    return merged;
+}
+
+TickProfiler::Stats TickProfiler::summarize(const Snapshot& snapshot) {
+    Stats stats;
+    for (size_t p = 0; p < PROFILE_POINT_COUNT; p++) {
+        stats[p] = LatencyHistogram::summarize(snapshot[p]);
+    }
+    return stats;
+}
+
+std::string TickProfiler::toJson(const Stats& stats) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << "{";
+    for (size_t p = 0; p < PROFILE_POINT_COUNT; p++) {
+        const auto& s = stats[p];
+        ss << (p ? "," : "") << "\"" << profilePointName(static_cast<ProfilePoint>(p)) << "\":{"
+           << "\"n\":" << s.count
+           << ",\"mean_us\":" << s.meanUs
+           << ",\"p50_us\":" << s.p50Us
+           << ",\"p99_us\":" << s.p99Us
+           << ",\"max_us\":" << s.maxUs << "}";
+    }
+    ss << "}";
+    return ss.str();
+}
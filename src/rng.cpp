@@ -0,0 +1,110 @@
+#include "../include/rng.h"
+#include <random>
+
+namespace {
+
+constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+constexpr int PHILOX_ROUNDS = 10;
+
+inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+    uint64_t product = static_cast<uint64_t>(a) * b;
+    hi = static_cast<uint32_t>(product >> 32);
+    lo = static_cast<uint32_t>(product);
+}
+
+uint64_t splitmix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+}
+
+Philox4x32::Counter Philox4x32::generate(Counter counter, Key key) {
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(PHILOX_M0, counter[0], hi0, lo0);
+        mulhilo(PHILOX_M1, counter[2], hi1, lo1);
+        counter = {hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0};
+        key[0] += PHILOX_W0;
+        key[1] += PHILOX_W1;
+    }
+    return counter;
+}
+
+RngStream::RngStream(uint64_t seed, uint64_t streamId, uint64_t position)
+    : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+      counter{static_cast<uint32_t>(position), static_cast<uint32_t>(position >> 32),
+              static_cast<uint32_t>(streamId), static_cast<uint32_t>(streamId >> 32)},
+      block{},
+      index(4) {}
+
+RngStream::result_type RngStream::operator()() {
+    if (index == 4) {
+        block = Philox4x32::generate(counter, key);
+        if (++counter[0] == 0) ++counter[1];
+        index = 0;
+    }
+    return block[index++];
+}
+
+double RngStream::uniform() {
+    uint32_t a = (*this)() >> 5;
+    uint32_t b = (*this)() >> 6;
+    return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+}
+
+double RngStream::uniform(double lo, double hi) {
+    return lo + (hi - lo) * uniform();
+}
+
+uint32_t RngStream::below(uint32_t bound) {
+    if (bound <= 1) return 0;
+    uint32_t limit = max() - (max() % bound + 1) % bound;
+    uint32_t value;
+    do {
+        value = (*this)();
+    } while (value > limit);
+    return value % bound;
+}
+
+int RngStream::rollDice() {
+    return static_cast<int>(below(6)) + 1;
+}
+
+uint64_t RngStream::position() const {
+    return (static_cast<uint64_t>(counter[1]) << 32) | counter[0];
+}
+
+std::atomic<uint64_t> RngService::seedValue{RngService::randomSeed()};
+std::atomic<uint64_t> RngService::nextThreadStream{0};
+
+void RngService::setGlobalSeed(uint64_t seed) {
+    seedValue.store(seed);
+}
+
+uint64_t RngService::globalSeed() {
+    return seedValue.load();
+}
+
+uint64_t RngService::randomSeed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+}
+
+uint64_t RngService::streamId(RngDomain domain, uint64_t id) {
+    return splitmix(splitmix(static_cast<uint64_t>(domain)) ^ id);
+}
+
+RngStream RngService::stream(uint64_t seed, RngDomain domain, uint64_t id, uint64_t position) {
+    return RngStream(seed, streamId(domain, id), position);
+}
+
+RngStream& RngService::threadStream() {
+    thread_local RngStream stream(globalSeed(), streamId(RngDomain::THREAD, nextThreadStream.fetch_add(1)));
+    return stream;
+}
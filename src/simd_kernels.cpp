@@ -0,0 +1,268 @@
+#include "../include/simd_kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_KERNELS_X86 1
+#endif
+
+namespace simd {
+
+namespace {
+
+void moveScalar(const double* srcX, const double* srcY, const double* dirX, const double* dirY,
+                const double* step, double* dstX, double* dstY, size_t begin, size_t count,
+                const Bounds& bounds) {
+    for (size_t i = begin; i < count; i++) {
+        double length = std::sqrt(dirX[i] * dirX[i] + dirY[i] * dirY[i]);
+        double scale = length > 0 ? step[i] / length : 0.0;
+        dstX[i] = std::clamp(srcX[i] + dirX[i] * scale, bounds.minX, bounds.maxX);
+        dstY[i] = std::clamp(srcY[i] + dirY[i] * scale, bounds.minY, bounds.maxY);
+    }
+}
+
+void distancesScalar(double ax, double ay, const double* xs, const double* ys, double* out,
+                     size_t begin, size_t count) {
+    for (size_t i = begin; i < count; i++) {
+        double dx = xs[i] - ax;
+        double dy = ys[i] - ay;
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+size_t withinScalar(double ax, double ay, const double* xs, const double* ys, size_t begin,
+                    size_t count, double radiusSq, uint32_t* hits, size_t found) {
+    for (size_t i = begin; i < count; i++) {
+        double dx = xs[i] - ax;
+        double dy = ys[i] - ay;
+        if (dx * dx + dy * dy <= radiusSq) {
+            hits[found++] = static_cast<uint32_t>(i);
+        }
+    }
+    return found;
+}
+
+void moveBlockScalar(const double* srcX, const double* srcY, const double* dirX, const double* dirY,
+                     const double* step, double* dstX, double* dstY, size_t count, const Bounds& bounds) {
+    moveScalar(srcX, srcY, dirX, dirY, step, dstX, dstY, 0, count, bounds);
+}
+
+void distancesSquaredScalar(double ax, double ay, const double* xs, const double* ys, double* out,
+                            size_t count) {
+    distancesScalar(ax, ay, xs, ys, out, 0, count);
+}
+
+size_t withinRadiusScalar(double ax, double ay, const double* xs, const double* ys, size_t count,
+                          double radiusSq, uint32_t* hits) {
+    return withinScalar(ax, ay, xs, ys, 0, count, radiusSq, hits, 0);
+}
+
+#ifdef SIMD_KERNELS_X86
+
+__attribute__((target("sse4.1")))
+void moveBlockSse4(const double* srcX, const double* srcY, const double* dirX, const double* dirY,
+                   const double* step, double* dstX, double* dstY, size_t count, const Bounds& bounds) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d minX = _mm_set1_pd(bounds.minX);
+    const __m128d maxX = _mm_set1_pd(bounds.maxX);
+    const __m128d minY = _mm_set1_pd(bounds.minY);
+    const __m128d maxY = _mm_set1_pd(bounds.maxY);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d dx = _mm_loadu_pd(dirX + i);
+        __m128d dy = _mm_loadu_pd(dirY + i);
+        __m128d length = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+        __m128d scale = _mm_div_pd(_mm_loadu_pd(step + i), length);
+        scale = _mm_blendv_pd(zero, scale, _mm_cmpgt_pd(length, zero));
+        __m128d x = _mm_add_pd(_mm_loadu_pd(srcX + i), _mm_mul_pd(dx, scale));
+        __m128d y = _mm_add_pd(_mm_loadu_pd(srcY + i), _mm_mul_pd(dy, scale));
+        _mm_storeu_pd(dstX + i, _mm_min_pd(_mm_max_pd(x, minX), maxX));
+        _mm_storeu_pd(dstY + i, _mm_min_pd(_mm_max_pd(y, minY), maxY));
+    }
+    moveScalar(srcX, srcY, dirX, dirY, step, dstX, dstY, i, count, bounds);
+}
+
+__attribute__((target("sse4.1")))
+void distancesSquaredSse4(double ax, double ay, const double* xs, const double* ys, double* out,
+                          size_t count) {
+    const __m128d px = _mm_set1_pd(ax);
+    const __m128d py = _mm_set1_pd(ay);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), px);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), py);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+    }
+    distancesScalar(ax, ay, xs, ys, out, i, count);
+}
+
+__attribute__((target("sse4.1")))
+size_t withinRadiusSse4(double ax, double ay, const double* xs, const double* ys, size_t count,
+                        double radiusSq, uint32_t* hits) {
+    const __m128d px = _mm_set1_pd(ax);
+    const __m128d py = _mm_set1_pd(ay);
+    const __m128d limit = _mm_set1_pd(radiusSq);
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), px);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), py);
+        __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        int mask = _mm_movemask_pd(_mm_cmple_pd(d2, limit));
+        if (mask & 1) hits[found++] = static_cast<uint32_t>(i);
+        if (mask & 2) hits[found++] = static_cast<uint32_t>(i + 1);
+    }
+    return withinScalar(ax, ay, xs, ys, i, count, radiusSq, hits, found);
+}
+
+__attribute__((target("avx2")))
+void moveBlockAvx2(const double* srcX, const double* srcY, const double* dirX, const double* dirY,
+                   const double* step, double* dstX, double* dstY, size_t count, const Bounds& bounds) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d minX = _mm256_set1_pd(bounds.minX);
+    const __m256d maxX = _mm256_set1_pd(bounds.maxX);
+    const __m256d minY = _mm256_set1_pd(bounds.minY);
+    const __m256d maxY = _mm256_set1_pd(bounds.maxY);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_loadu_pd(dirX + i);
+        __m256d dy = _mm256_loadu_pd(dirY + i);
+        __m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+        __m256d scale = _mm256_div_pd(_mm256_loadu_pd(step + i), length);
+        scale = _mm256_blendv_pd(zero, scale, _mm256_cmp_pd(length, zero, _CMP_GT_OQ));
+        __m256d x = _mm256_add_pd(_mm256_loadu_pd(srcX + i), _mm256_mul_pd(dx, scale));
+        __m256d y = _mm256_add_pd(_mm256_loadu_pd(srcY + i), _mm256_mul_pd(dy, scale));
+        _mm256_storeu_pd(dstX + i, _mm256_min_pd(_mm256_max_pd(x, minX), maxX));
+        _mm256_storeu_pd(dstY + i, _mm256_min_pd(_mm256_max_pd(y, minY), maxY));
+    }
+    moveScalar(srcX, srcY, dirX, dirY, step, dstX, dstY, i, count, bounds);
+}
+
+__attribute__((target("avx2")))
+void distancesSquaredAvx2(double ax, double ay, const double* xs, const double* ys, double* out,
+                          size_t count) {
+    const __m256d px = _mm256_set1_pd(ax);
+    const __m256d py = _mm256_set1_pd(ay);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), px);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), py);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+    }
+    distancesScalar(ax, ay, xs, ys, out, i, count);
+}
+
+__attribute__((target("avx2")))
+size_t withinRadiusAvx2(double ax, double ay, const double* xs, const double* ys, size_t count,
+                        double radiusSq, uint32_t* hits) {
+    const __m256d px = _mm256_set1_pd(ax);
+    const __m256d py = _mm256_set1_pd(ay);
+    const __m256d limit = _mm256_set1_pd(radiusSq);
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), px);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), py);
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, limit, _CMP_LE_OQ));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            hits[found++] = static_cast<uint32_t>(i + bit);
+            mask &= mask - 1;
+        }
+    }
+    return withinScalar(ax, ay, xs, ys, i, count, radiusSq, hits, found);
+}
+
+#endif
+
+struct Kernels {
+    Backend backend;
+    decltype(&moveBlockScalar) move;
+    decltype(&distancesSquaredScalar) distances;
+    decltype(&withinRadiusScalar) within;
+};
+
+const Kernels SCALAR_KERNELS = {Backend::SCALAR, moveBlockScalar, distancesSquaredScalar, withinRadiusScalar};
+#ifdef SIMD_KERNELS_X86
+const Kernels SSE4_KERNELS = {Backend::SSE4, moveBlockSse4, distancesSquaredSse4, withinRadiusSse4};
+const Kernels AVX2_KERNELS = {Backend::AVX2, moveBlockAvx2, distancesSquaredAvx2, withinRadiusAvx2};
+#endif
+
+bool supported(Backend backend) {
+    switch (backend) {
+        case Backend::SCALAR:
+            return true;
+#ifdef SIMD_KERNELS_X86
+        case Backend::SSE4:
+            return __builtin_cpu_supports("sse4.1");
+        case Backend::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+const Kernels* kernelsFor(Backend backend) {
+#ifdef SIMD_KERNELS_X86
+    if (backend == Backend::AVX2) return &AVX2_KERNELS;
+    if (backend == Backend::SSE4) return &SSE4_KERNELS;
+#endif
+    return &SCALAR_KERNELS;
+}
+
+const Kernels* detect() {
+    if (supported(Backend::AVX2)) return kernelsFor(Backend::AVX2);
+    if (supported(Backend::SSE4)) return kernelsFor(Backend::SSE4);
+    return &SCALAR_KERNELS;
+}
+
+// setBackend может вызываться, пока фазы тика уже идут в других потоках.
+std::atomic<const Kernels*>& activeKernels() {
+    static std::atomic<const Kernels*> kernels{detect()};
+    return kernels;
+}
+
+const Kernels* active() {
+    return activeKernels().load(std::memory_order_relaxed);
+}
+
+}
+
+void moveBlock(const double* srcX, const double* srcY, const double* dirX, const double* dirY,
+               const double* step, double* dstX, double* dstY, size_t count, const Bounds& bounds) {
+    active()->move(srcX, srcY, dirX, dirY, step, dstX, dstY, count, bounds);
+}
+
+void distancesSquared(double ax, double ay, const double* xs, const double* ys, double* out, size_t count) {
+    active()->distances(ax, ay, xs, ys, out, count);
+}
+
+size_t withinRadius(double ax, double ay, const double* xs, const double* ys, size_t count,
+                    double radiusSq, uint32_t* hits) {
+    return active()->within(ax, ay, xs, ys, count, radiusSq, hits);
+}
+
+Backend activeBackend() {
+    return active()->backend;
+}
+
+bool setBackend(Backend backend) {
+    if (!supported(backend)) return false;
+    activeKernels().store(kernelsFor(backend), std::memory_order_relaxed);
+    return true;
+}
+
+const char* backendName(Backend backend) {
+    switch (backend) {
+        case Backend::SCALAR: return "scalar";
+        case Backend::SSE4: return "sse4.1";
+        case Backend::AVX2: return "avx2";
+        default: return "unknown";
+    }
+}
+
+}
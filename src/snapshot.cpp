@@ -0,0 +1,177 @@
+#include "../include/snapshot.h"
+#include <array>
+#include <bit>
+#include <cstring>
+
+static_assert(std::endian::native == std::endian::little, "snapshot format assumes a little-endian host");
+
+namespace {
+
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr CrcTables makeCrcTables() {
+    CrcTables tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u);
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t t = 1; t < 8; t++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr CrcTables CRC_TABLES = makeCrcTables();
+
+template<typename T>
+void put(std::vector<uint8_t>& out, size_t offset, T value) {
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+T get(const uint8_t* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+}
+
+namespace snapshot {
+
+// CRC-32 (IEEE), slicing-by-8.
+uint32_t crc32(const void* data, size_t size, uint32_t crc) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t lo = get<uint32_t>(bytes) ^ crc;
+        uint32_t hi = get<uint32_t>(bytes + 4);
+        crc = CRC_TABLES[7][lo & 0xFF] ^ CRC_TABLES[6][(lo >> 8) & 0xFF] ^
+              CRC_TABLES[5][(lo >> 16) & 0xFF] ^ CRC_TABLES[4][lo >> 24] ^
+              CRC_TABLES[3][hi & 0xFF] ^ CRC_TABLES[2][(hi >> 8) & 0xFF] ^
+              CRC_TABLES[1][(hi >> 16) & 0xFF] ^ CRC_TABLES[0][hi >> 24];
+        bytes += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = (crc >> 8) ^ CRC_TABLES[0][(crc ^ *bytes++) & 0xFF];
+    }
+    return ~crc;
+}
+
+void encodeWorld(const NpcWorld& world, std::vector<uint8_t>& out) {
+    size_t count = world.size();
+    uint64_t nameBytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        nameBytes += world.name(i).size();
+    }
+    uint64_t payloadBytes = count * 2 * sizeof(double) + (count + 1) * sizeof(uint32_t) + count * 2 + nameBytes;
+
+    size_t start = out.size();
+    out.resize(start + HEADER_SIZE + payloadBytes);
+    uint8_t* payload = out.data() + start + HEADER_SIZE;
+
+    world.readFront([&](const NpcWorld::Positions& positions) {
+        std::memcpy(payload, positions.x.data(), count * sizeof(double));
+        std::memcpy(payload + count * sizeof(double), positions.y.data(), count * sizeof(double));
+    });
+
+    uint8_t* offsets = payload + count * 2 * sizeof(double);
+    uint8_t* kinds = offsets + (count + 1) * sizeof(uint32_t);
+    uint8_t* alive = kinds + count;
+    uint8_t* names = alive + count;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        const std::string& name = world.name(i);
+        std::memcpy(offsets + i * sizeof(uint32_t), &offset, sizeof(uint32_t));
+        std::memcpy(names + offset, name.data(), name.size());
+        offset += static_cast<uint32_t>(name.size());
+        kinds[i] = static_cast<uint8_t>(world.kind(i));
+        alive[i] = world.isAlive(i) ? 1 : 0;
+    }
+    std::memcpy(offsets + count * sizeof(uint32_t), &offset, sizeof(uint32_t));
+
+    std::memcpy(out.data() + start, MAGIC, 4);
+    put<uint16_t>(out, start + 4, VERSION);
+    put<uint16_t>(out, start + 6, 0);
+    put<uint64_t>(out, start + 8, count);
+    put<uint64_t>(out, start + 16, nameBytes);
+    put<uint64_t>(out, start + 24, payloadBytes);
+    put<uint32_t>(out, start + 32, crc32(payload, payloadBytes));
+    put<uint32_t>(out, start + 36, 0);
+}
+
+bool decodeWorld(std::span<const uint8_t> data, NpcWorld& world, std::string& error, size_t* consumed) {
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, 4) != 0) {
+        error = "not an NPC snapshot";
+        return false;
+    }
+    uint16_t version = get<uint16_t>(data.data() + 4);
+    if (version != VERSION) {
+        error = "unsupported snapshot version " + std::to_string(version);
+        return false;
+    }
+    uint64_t count = get<uint64_t>(data.data() + 8);
+    uint64_t nameBytes = get<uint64_t>(data.data() + 16);
+    uint64_t payloadBytes = get<uint64_t>(data.data() + 24);
+    uint32_t expectedCrc = get<uint32_t>(data.data() + 32);
+
+    if (count > (data.size() / 10) || nameBytes > data.size() ||
+        payloadBytes != count * 2 * sizeof(double) + (count + 1) * sizeof(uint32_t) + count * 2 + nameBytes ||
+        payloadBytes > data.size() - HEADER_SIZE) {
+        error = "truncated or inconsistent snapshot";
+        return false;
+    }
+    const uint8_t* payload = data.data() + HEADER_SIZE;
+    if (crc32(payload, payloadBytes) != expectedCrc) {
+        error = "snapshot checksum mismatch";
+        return false;
+    }
+
+    const uint8_t* offsets = payload + count * 2 * sizeof(double);
+    const uint8_t* kindBytes = offsets + (count + 1) * sizeof(uint32_t);
+    const uint8_t* aliveBytes = kindBytes + count;
+    const char* nameData = reinterpret_cast<const char*>(aliveBytes + count);
+
+    std::vector<double> xs(count), ys(count);
+    std::memcpy(xs.data(), payload, count * sizeof(double));
+    std::memcpy(ys.data(), payload + count * sizeof(double), count * sizeof(double));
+
+    std::vector<NPCKind> kinds(count);
+    std::vector<std::string_view> names(count);
+    uint32_t previous = get<uint32_t>(offsets);
+    if (previous != 0) {
+        error = "corrupt name table";
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t next = get<uint32_t>(offsets + (i + 1) * sizeof(uint32_t));
+        if (next < previous || next > nameBytes || kindBytes[i] >= NPC_KIND_COUNT) {
+            error = "corrupt record " + std::to_string(i);
+            return false;
+        }
+        names[i] = std::string_view(nameData + previous, next - previous);
+        kinds[i] = static_cast<NPCKind>(kindBytes[i]);
+        previous = next;
+    }
+    if (previous != nameBytes) {
+        error = "corrupt name table";
+        return false;
+    }
+
+    world.clear();
+    world.reserve(count);
+    world.append(kinds, xs, ys, names);
+    for (size_t i = 0; i < count; i++) {
+        if (!aliveBytes[i]) world.kill(i);
+    }
+    if (consumed) *consumed = HEADER_SIZE + payloadBytes;
+    return true;
+}
+
+}
@@ -0,0 +1,54 @@
+#include "../include/spatial_grid.h"
+
+SpatialGrid::SpatialGrid(double minX, double maxX, double minY, double maxY, double cellSize)
+    : minX(minX), minY(minY), cellSize(cellSize > 0 ? cellSize : 1.0) {
+    cols = std::max<size_t>(1, static_cast<size_t>(std::ceil((maxX - minX) / this->cellSize)));
+    rows = std::max<size_t>(1, static_cast<size_t>(std::ceil((maxY - minY) / this->cellSize)));
+    cells.resize(cols * rows);
+}
+
+size_t SpatialGrid::cellIndex(double x, double y) const {
+    return static_cast<size_t>(cellCoord(y - minY, rows)) * cols
+         + static_cast<size_t>(cellCoord(x - minX, cols));
+}
+
+void SpatialGrid::insert(size_t id, double x, double y) {
+    if (id >= cellOfId.size()) {
+        cellOfId.resize(id + 1, NO_CELL);
+        slotOfId.resize(id + 1, 0);
+    }
+    if (cellOfId[id] != NO_CELL) {
+        update(id, x, y);
+        return;
+    }
+    size_t index = cellIndex(x, y);
+    cellOfId[id] = index;
+    slotOfId[id] = static_cast<uint32_t>(cells[index].size());
+    cells[index].push_back(static_cast<uint32_t>(id));
+}
+
+void SpatialGrid::update(size_t id, double x, double y) {
+    if (id >= cellOfId.size() || cellOfId[id] == NO_CELL) {
+        insert(id, x, y);
+        return;
+    }
+    if (cellOfId[id] == cellIndex(x, y)) return;
+    remove(id);
+    insert(id, x, y);
+}
+
+void SpatialGrid::remove(size_t id) {
+    if (id >= cellOfId.size() || cellOfId[id] == NO_CELL) return;
+    auto& bucket = cells[cellOfId[id]];
+    uint32_t slot = slotOfId[id];
+    uint32_t last = bucket.back();
+    bucket[slot] = last;
+    slotOfId[last] = slot;
+    bucket.pop_back();
+    cellOfId[id] = NO_CELL;
+}
+
+void SpatialGrid::clear() {
+    for (auto& bucket : cells) bucket.clear();
+    std::fill(cellOfId.begin(), cellOfId.end(), NO_CELL);
+}
@@ -0,0 +1,103 @@
+#include "../include/tick_scheduler.h"
+#include <algorithm>
+#include <thread>
+
+const char* tickPhaseName(TickPhase phase) {
+    switch (phase) {
+        case TickPhase::MOVE: return "move";
+        case TickPhase::DETECT: return "detect";
+        case TickPhase::RESOLVE: return "resolve";
+        case TickPhase::OBSERVE: return "observe";
+        default: return "unknown";
+    }
+}
+
+TickScheduler::TickScheduler(double ticksPerSecond) {
+    setTickRate(ticksPerSecond);
+}
+
+void TickScheduler::setPhase(TickPhase phase, PhaseFn fn) {
+    phases[static_cast<size_t>(phase)] = std::move(fn);
+}
+
+void TickScheduler::setTickRate(double rate) {
+    rate = rate > 0.0 ? rate : 0.0;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ticksPerSecond.store(rate, std::memory_order_relaxed);
+    stats.budgetMs = rate > 0.0 ? 1000.0 / rate : 0.0;
+}
+
+bool TickScheduler::step() {
+    uint64_t tick = completedTicks.load() + 1;
+    std::array<double, TICK_PHASE_COUNT> phaseMs{};
+
+    auto tickStart = Clock::now();
+    auto phaseStart = tickStart;
+    for (size_t i = 0; i < TICK_PHASE_COUNT; i++) {
+        if (phases[i]) {
+            phases[i](tick);
+        }
+        auto phaseEnd = Clock::now();
+        phaseMs[i] = std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+        phaseStart = phaseEnd;
+    }
+    double tickMs = std::chrono::duration<double, std::milli>(phaseStart - tickStart).count();
+
+    completedTicks.store(tick);
+    record(tickMs, phaseMs);
+    double rate = getTickRate();
+    return rate > 0.0 && tickMs > 1000.0 / rate;
+}
+
+uint64_t TickScheduler::run(uint64_t maxTicks, const std::atomic<bool>& running) {
+    uint64_t executed = 0;
+    auto deadline = Clock::now();
+
+    while (running && executed < maxTicks) {
+        step();
+        executed++;
+
+        double rate = getTickRate();
+        if (rate <= 0.0) continue;
+
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        deadline += period;
+        auto now = Clock::now();
+        if (now < deadline) {
+            std::this_thread::sleep_until(deadline);
+        } else {
+            // Отстали — не пытаемся догонять пачкой тиков, начинаем отсчёт заново.
+            deadline = now;
+        }
+    }
+    return executed;
+}
+
+void TickScheduler::record(double tickMs, const std::array<double, TICK_PHASE_COUNT>& phaseMs) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.ticks++;
+    if (stats.budgetMs > 0.0 && tickMs > stats.budgetMs) {
+        stats.overruns++;
+    }
+    stats.lastTickMs = tickMs;
+    stats.maxTickMs = std::max(stats.maxTickMs, tickMs);
+    totalTickMs += tickMs;
+    stats.avgTickMs = totalTickMs / static_cast<double>(stats.ticks);
+    for (size_t i = 0; i < TICK_PHASE_COUNT; i++) {
+        stats.lastPhaseMs[i] = phaseMs[i];
+        stats.maxPhaseMs[i] = std::max(stats.maxPhaseMs[i], phaseMs[i]);
+    }
+}
+
+TickScheduler::Stats TickScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
+
+void TickScheduler::resetStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    double budget = stats.budgetMs;
+    stats = Stats{};
+    stats.budgetMs = budget;
+    totalTickMs = 0.0;
+}
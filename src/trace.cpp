@@ -0,0 +1,163 @@
+#include "../include/trace.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t startNs;
+    uint64_t durationNs;
+};
+
+// Кольцо одного потока: пишет только владелец, head публикуется с release.
+struct Ring {
+    std::array<Event, trace::RING_CAPACITY> events;
+    std::atomic<uint64_t> head{0};
+    size_t tid = 0;
+    std::string threadName;
+    bool owned = false;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<Ring>> rings;
+std::atomic<uint64_t> epochNs{0};
+
+// Имя потока хранится отдельно: кольцо заводится только при первой записи.
+// Когда поток завершается, его кольцо освобождается, но события остаются до
+// следующего start(); после него кольцо достаётся новому потоку.
+struct ThreadSlot {
+    Ring* ring = nullptr;
+    std::string name;
+
+    ~ThreadSlot() {
+        if (!ring) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ring->owned = false;
+    }
+};
+
+thread_local ThreadSlot localSlot;
+
+Ring* threadRing() {
+    if (localSlot.ring) return localSlot.ring;
+    if (!trace::recording.load(std::memory_order_relaxed)) return nullptr;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Ring* ring = nullptr;
+    for (auto& candidate : rings) {
+        if (!candidate->owned && candidate->head.load(std::memory_order_relaxed) == 0) {
+            ring = candidate.get();
+            break;
+        }
+    }
+    if (!ring) {
+        rings.push_back(std::make_unique<Ring>());
+        ring = rings.back().get();
+        ring->tid = rings.size();
+    }
+    ring->owned = true;
+    ring->threadName = localSlot.name.empty() ? "thread-" + std::to_string(ring->tid) : localSlot.name;
+    localSlot.ring = ring;
+    return ring;
+}
+
+void writeEscaped(std::ostream& out, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+}
+
+}
+
+namespace trace {
+
+void start() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& ring : rings) {
+        ring->head.store(0, std::memory_order_relaxed);
+    }
+    epochNs.store(nowNs());
+    recording.store(true);
+}
+
+void stop() {
+    recording.store(false);
+}
+
+void setThreadName(const std::string& name) {
+    localSlot.name = name;
+    if (localSlot.ring) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        localSlot.ring->threadName = name;
+    }
+}
+
+void record(const char* name, uint64_t startNs, uint64_t endNs) {
+    Ring* ring = threadRing();
+    if (!ring) return;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head & (RING_CAPACITY - 1)] = {name, startNs, endNs - startNs};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+size_t ringCount() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return rings.size();
+}
+
+size_t droppedCount() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t dropped = 0;
+    for (const auto& ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (head > RING_CAPACITY) dropped += head - RING_CAPACITY;
+    }
+    return dropped;
+}
+
+bool writeChromeJson(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "Error: cannot open trace file " << filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t epoch = epochNs.load();
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (head == 0) continue;
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid
+             << ",\"args\":{\"name\":\"";
+        writeEscaped(file, ring->threadName);
+        file << "\"}}";
+        first = false;
+
+        uint64_t begin = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+        for (uint64_t i = begin; i < head; i++) {
+            const Event& event = ring->events[i & (RING_CAPACITY - 1)];
+            if (event.startNs < epoch) continue;
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+                 << ",\"ts\":" << (event.startNs - epoch) / 1000.0
+                 << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+    if (!file) {
+        std::cerr << "Error: failed to write trace file " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
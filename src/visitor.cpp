@@ -1,78 +1,249 @@
 #include "../include/visitor.h"
 #include "../include/npc.h"
 #include "../include/observer.h"
+#include "../include/spatial_grid.h"
 #include <iostream>
 #include <algorithm>
 #include <chrono>
 
+BattleQueue::BattleQueue(size_t shardCount, bool coalescePairs)
+    : coalescePairs(coalescePairs) {
+    shards.resize(std::max<size_t>(1, shardCount));
+    for (auto& shard : shards) {
+        shard = std::make_unique<Shard>();
+    }
+}
+
+void BattleQueue::setStaleFilter(StaleFilter filter) {
+    isStale = std::move(filter);
+}
+
+size_t BattleQueue::shardFor(const BattleTask& task) const {
+    size_t key = task.defenderId != BattleTask::NO_ID
+        ? task.defenderId
+        : std::hash<const NPC*>()(task.defender.get());
+    return key % shards.size();
+}
+
+uint64_t BattleQueue::pairKey(const BattleTask& task) {
+    return (static_cast<uint64_t>(task.attackerId) << 32) | static_cast<uint32_t>(task.defenderId);
+}
+
+bool BattleQueue::pushLocked(Shard& shard, const BattleTask& task) {
+    if (coalescePairs && task.hasIds() && !shard.queuedPairs.insert(pairKey(task)).second) {
+        coalesced.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    shard.tasks.push_back(task);
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+    pending.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool BattleQueue::takeLocked(Shard& shard, BattleTask& task, bool fromBack) {
+    while (!shard.tasks.empty()) {
+        if (fromBack) {
+            task = std::move(shard.tasks.back());
+            shard.tasks.pop_back();
+        } else {
+            task = std::move(shard.tasks.front());
+            shard.tasks.pop_front();
+        }
+        pending.fetch_sub(1, std::memory_order_acq_rel);
+        if (coalescePairs && task.hasIds()) {
+            shard.queuedPairs.erase(pairKey(task));
+        }
+        if (isStale && isStale(task)) {
+            staleDropped.fetch_add(1, std::memory_order_relaxed);
+            finish(1);
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+void BattleQueue::wakeWorkers(size_t added) {
+    if (added == 0) return;
+    {
+        std::lock_guard<WaitMutex> lock(mtx);
+    }
+    if (added > 1) {
+        cv.notify_all();
+    } else {
+        cv.notify_one();
+    }
+}
+
 void BattleQueue::addTask(const BattleTask& task) {
-    std::lock_guard<std::mutex> lock(mtx);
-    tasks.push(task);
-    cv.notify_one();
+    bool added;
+    {
+        auto& shard = *shards[shardFor(task)];
+        std::lock_guard<ShardMutex> lock(shard.mtx);
+        added = pushLocked(shard, task);
+    }
+    wakeWorkers(added ? 1 : 0);
 }
 
-bool BattleQueue::tryGetTask(BattleTask& task) {
-    std::unique_lock<std::mutex> lock(mtx);
+void BattleQueue::addTasks(std::span<const BattleTask> batch) {
+    if (batch.empty()) return;
     
-    cv.wait_for(lock, std::chrono::milliseconds(100), 
-                [this]() { return !tasks.empty() || stopFlag; });
+    // Буферы потока переиспользуются между пачками: в фазе поиска боёв без выделений.
+    thread_local std::vector<uint32_t> shardOf;
+    thread_local std::vector<size_t> perShard;
+    shardOf.resize(batch.size());
+    perShard.assign(shards.size(), 0);
+    for (size_t i = 0; i < batch.size(); i++) {
+        shardOf[i] = static_cast<uint32_t>(shardFor(batch[i]));
+        perShard[shardOf[i]]++;
+    }
     
-    if (stopFlag && tasks.empty()) {
+    size_t added = 0;
+    for (size_t s = 0; s < shards.size(); s++) {
+        if (perShard[s] == 0) continue;
+        auto& shard = *shards[s];
+        std::lock_guard<ShardMutex> lock(shard.mtx);
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (shardOf[i] == s && pushLocked(shard, batch[i])) added++;
+        }
+    }
+    wakeWorkers(added);
+}
+
+size_t BattleQueue::popManyFrom(size_t shard, std::vector<BattleTask>& out, size_t maxCount, bool fromBack) {
+    auto& source = *shards[shard];
+    std::lock_guard<ShardMutex> lock(source.mtx);
+    size_t taken = 0;
+    BattleTask task;
+    while (taken < maxCount && takeLocked(source, task, fromBack)) {
+        out.push_back(std::move(task));
+        taken++;
+    }
+    return taken;
+}
+
+size_t BattleQueue::drainInto(std::vector<BattleTask>& out, size_t maxCount, size_t worker) {
+    if (maxCount == 0 || !waitForWork(std::chrono::milliseconds(100))) {
+        return 0;
+    }
+    
+    size_t own = worker % shards.size();
+    size_t taken = popManyFrom(own, out, maxCount, false);
+    for (size_t offset = 1; offset < shards.size() && taken < maxCount; offset++) {
+        taken += popManyFrom((own + offset) % shards.size(), out, maxCount - taken, true);
+    }
+    return taken;
+}
+
+bool BattleQueue::popFrom(size_t shard, BattleTask& task, bool fromBack) {
+    auto& source = *shards[shard];
+    std::lock_guard<ShardMutex> lock(source.mtx);
+    return takeLocked(source, task, fromBack);
+}
+
+bool BattleQueue::waitForWork(std::chrono::milliseconds timeout) {
+    std::unique_lock<WaitMutex> lock(mtx);
+    cv.wait_for(lock, timeout, [this]() {
+        return pending.load(std::memory_order_acquire) > 0 || stopFlag.load();
+    });
+    return pending.load(std::memory_order_acquire) > 0;
+}
+
+bool BattleQueue::tryGetTask(BattleTask& task) {
+    return tryGetTask(task, 0);
+}
+
+bool BattleQueue::tryGetTask(BattleTask& task, size_t worker) {
+    if (!waitForWork(std::chrono::milliseconds(100))) {
         return false;
     }
     
-    if (!tasks.empty()) {
-        task = tasks.front();
-        tasks.pop();
+    size_t own = worker % shards.size();
+    if (popFrom(own, task, false)) {
         return true;
     }
-    
+    for (size_t offset = 1; offset < shards.size(); offset++) {
+        if (popFrom((own + offset) % shards.size(), task, true)) {
+            return true;
+        }
+    }
     return false;
 }
 
+void BattleQueue::finish(size_t count) {
+    if (count == 0) return;
+    if (unfinished.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        {
+            std::lock_guard<WaitMutex> lock(mtx);
+        }
+        idleCv.notify_all();
+    }
+}
+
+void BattleQueue::completeTasks(size_t count) {
+    finish(count);
+}
+
+bool BattleQueue::waitUntilIdle() {
+    std::unique_lock<WaitMutex> lock(mtx);
+    idleCv.wait(lock, [this]() {
+        return unfinished.load(std::memory_order_acquire) == 0 || stopFlag.load();
+    });
+    return unfinished.load(std::memory_order_acquire) == 0;
+}
+
 void BattleQueue::stop() {
-    std::lock_guard<std::mutex> lock(mtx);
-    stopFlag = true;
+    {
+        std::lock_guard<WaitMutex> lock(mtx);
+        stopFlag = true;
+    }
     cv.notify_all();
+    idleCv.notify_all();
 }
 
 bool BattleQueue::isEmpty() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return tasks.empty();
+    return pending.load(std::memory_order_acquire) == 0;
 }
 
 bool BattleQueue::shouldStop() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return stopFlag && tasks.empty();
+    return stopFlag.load() && isEmpty();
 }
 
 size_t BattleQueue::size() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return tasks.size();
+    return pending.load(std::memory_order_acquire);
 }
+
 void DetectionVisitor::detectForNPC(NPC* npc) {
     if (!npc->isAlive()) return;
-    std::vector<std::shared_ptr<NPC>> aliveTargets;
-    {
-        for (auto& target : npcs) {
-            if (target && target != currentNPC && target->isAlive()) {
-                aliveTargets.push_back(target);
-            }
+    double attackDistance = npc->getAttackDistance();
+    
+    thread_local std::vector<BattleTask> found;
+    found.clear();
+    auto consider = [&](const std::shared_ptr<NPC>& target) {
+        if (!target || target == currentNPC || !target->isAlive()) return;
+        double distanceSq = npc->calculateDistanceSquared(target.get());
+        if (distanceSq <= attackDistance * attackDistance && npc->canAttack(target.get())) {
+            found.emplace_back(currentNPC, target);
         }
-    }
+    };
     
-    for (auto& target : aliveTargets) {
-        double distance = npc->calculateDistance(target.get());
-        if (distance <= npc->getAttackDistance()) {
-            if (npc->canAttack(target.get())) {
-                battleQueue.addTask(BattleTask(currentNPC, target));
-            }
+    if (grid) {
+        grid->forEachNear(npc->getX(), npc->getY(), attackDistance, [&](size_t id) {
+            if (id < npcs.size()) consider(npcs[id]);
+        });
+    } else {
+        for (auto& target : npcs) {
+            consider(target);
         }
     }
+    
+    battleQueue.addTasks(found);
+    found.clear();
 }
 
-DetectionVisitor::DetectionVisitor(std::vector<std::shared_ptr<NPC>>& npcs, BattleQueue& queue, std::shared_ptr<NPC> npc)
-    : npcs(npcs), battleQueue(queue), currentNPC(npc) {}
+DetectionVisitor::DetectionVisitor(std::vector<std::shared_ptr<NPC>>& npcs, BattleQueue& queue, std::shared_ptr<NPC> npc,
+                                   const SpatialGrid* grid)
+    : npcs(npcs), battleQueue(queue), currentNPC(npc), grid(grid) {}
 
 void DetectionVisitor::visit(Squirrel* squirrel) {
     detectForNPC(squirrel);
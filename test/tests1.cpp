@@ -3,12 +3,26 @@
 #include "../include/npc_factory.h"
 #include "../include/visitor.h"
 #include "../include/observer.h"
+#include "../include/battle_log.h"
+#include "../include/snapshot.h"
+#include "../include/map_renderer.h"
 #include "../include/game_engine.h"
+#include "../include/spatial_grid.h"
+#include "../include/npc_world.h"
+#include "../include/simd_kernels.h"
+#include "../include/rng.h"
+#include "../include/tick_scheduler.h"
+#include "../include/profiler.h"
+#include "../include/trace.h"
+#include "../include/lock_stats.h"
+#include "../include/parallel_runner.h"
 #include <fstream>
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <set>
 #include <cstdio>
+#include <algorithm>
 
 using namespace std;
 
@@ -66,6 +80,19 @@ TEST(NPCTest, DruidAttackRules) {
     EXPECT_FALSE(druid.canAttack(&wolf));
 }
 
+TEST(NPCTest, AttackMatrixMatchesClasses) {
+    EXPECT_TRUE(kindCanAttack(NPCKind::SQUIRREL, NPCKind::WEREWOLF));
+    EXPECT_TRUE(kindCanAttack(NPCKind::SQUIRREL, NPCKind::DRUID));
+    EXPECT_FALSE(kindCanAttack(NPCKind::SQUIRREL, NPCKind::SQUIRREL));
+    EXPECT_TRUE(kindCanAttack(NPCKind::WEREWOLF, NPCKind::DRUID));
+    EXPECT_FALSE(kindCanAttack(NPCKind::DRUID, NPCKind::WEREWOLF));
+    
+    Werewolf wolf("Wolf", 100, 100);
+    EXPECT_EQ(wolf.getKind(), NPCKind::WEREWOLF);
+    EXPECT_DOUBLE_EQ(speciesTraits(NPCKind::WEREWOLF).moveDistance, wolf.getMoveDistance());
+    EXPECT_EQ(speciesTraits(NPCKind::WEREWOLF).mapSymbol, wolf.getMapSymbol());
+}
+
 TEST(NPCTest, MovementDistances) {
     Squirrel squirrel("Sq", 100, 100);
     Werewolf wolf("Wolf", 100, 100);
@@ -104,6 +131,43 @@ TEST(NPCTest, DiceRoll) {
     }
 }
 
+// Бросок боя — функция (seed, пара, тик): параллельные бои, в том числе
+// вперемешку с tryAttack на потоковых генераторах, дают ту же серию, что и
+// последовательный прогон.
+TEST(NPCTest, ConcurrentBattleRollsAreReproducible) {
+    const uint64_t seed = 4242;
+    const size_t battles = 20000;
+    const size_t threadCount = 4;
+    auto rollPair = [seed](size_t i) {
+        RngStream dice = RngService::stream(seed, RngDomain::BATTLE, (static_cast<uint64_t>(i) << 32) | (i * 7 + 1), i % 50);
+        int attack = NPC::rollDice(dice);
+        int defense = NPC::rollDice(dice);
+        return attack * 8 + defense;
+    };
+    
+    vector<int> expected(battles);
+    for (size_t i = 0; i < battles; i++) {
+        expected[i] = rollPair(i);
+    }
+    
+    vector<int> actual(battles);
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount; t++) {
+        workers.emplace_back([&actual, &rollPair, t] {
+            Squirrel squirrel("Sq", 100, 100);
+            Werewolf wolf("Wolf", 101, 101);
+            for (size_t i = t; i < battles; i += threadCount) {
+                squirrel.tryAttack(&wolf);
+                actual[i] = rollPair(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    EXPECT_EQ(actual, expected);
+}
+
 TEST(NPCTest, MovementWithinBounds) {
     Squirrel squirrel("Sq", 50.0, 50.0);
     for (int i = 0; i < 100; i++) {
@@ -115,6 +179,95 @@ TEST(NPCTest, MovementWithinBounds) {
     }
 }
 
+TEST(MapRendererTest, AnsiModeSendsOnlyChangedCells) {
+    NpcWorld world;
+    world.add(NPCKind::SQUIRREL, "S", 15.0, 15.0);
+    world.add(NPCKind::DRUID, "D", 95.0, 95.0);
+    
+    Viewport viewport;
+    viewport.width = 10;
+    viewport.height = 10;
+    MapRenderer renderer(MapRenderer::Mode::ANSI, viewport);
+    renderer.setBounds(0, 100, 0, 100);
+    
+    renderer.rasterize(world, world.front());
+    string first = renderer.present("header", {"status"});
+    EXPECT_NE(first.find("\x1b[2J"), string::npos);
+    EXPECT_EQ(renderer.cellAt(1, 1), 'S');
+    EXPECT_EQ(renderer.cellAt(9, 9), 'D');
+    
+    world.back().x = {25.0, 95.0};
+    world.back().y = {15.0, 95.0};
+    world.swapBuffers();
+    renderer.rasterize(world, world.front());
+    string second = renderer.present("header", {"status"});
+    EXPECT_EQ(renderer.changedCells(), 2u);
+    EXPECT_EQ(second.find("\x1b[2J"), string::npos);
+    EXPECT_EQ(second.find("header"), string::npos);
+    // Две соседние клетки одной строки уходят одним прогоном.
+    EXPECT_NE(second.find("\x1b[4;3H.S"), string::npos);
+    
+    Viewport zoomed = viewport;
+    zoomed.centerX = 90.0;
+    zoomed.centerY = 90.0;
+    zoomed.zoom = 5.0;
+    MapRenderer close(MapRenderer::Mode::TEXT, zoomed);
+    close.setBounds(0, 100, 0, 100);
+    close.rasterize(world, world.front());
+    close.present("header", {});
+    EXPECT_EQ(close.cellAt(7, 7), 'D');
+}
+
+TEST(MapRendererTest, DensityBinsMatchCounts) {
+    NpcWorld world;
+    const size_t count = 200000;
+    for (size_t i = 0; i < count; i++) {
+        // Половина NPC в одной клетке, остальные — по диагонали.
+        double pos = i % 2 ? 5.0 : static_cast<double>(i % 100);
+        world.add(i % 3 ? NPCKind::WEREWOLF : NPCKind::DRUID, "N", pos, pos);
+    }
+    world.kill(1);
+
+    Viewport viewport;
+    viewport.width = 10;
+    viewport.height = 10;
+    MapRenderer serial(MapRenderer::Mode::ANSI, viewport);
+    serial.setStyle(MapRenderer::Style::DENSITY);
+    serial.setBounds(0, 100, 0, 100);
+    serial.rasterize(world, world.front());
+    string frame = serial.present("header", {});
+
+    uint32_t total = 0;
+    for (size_t r = 0; r < viewport.height; r++) {
+        for (size_t c = 0; c < viewport.width; c++) {
+            for (uint32_t n : serial.binAt(c, r)) total += n;
+        }
+    }
+    EXPECT_EQ(total, count - 1);
+    EXPECT_EQ(serial.peakDensity(), 100000u + 10000u - 1);
+    EXPECT_EQ(serial.cellAt(0, 0), '@');
+    EXPECT_EQ(serial.cellAt(1, 0), ' ');
+    EXPECT_NE(serial.cellAt(9, 9), ' ');
+    // Оборотней в клетке вдвое больше — она окрашена их цветом.
+    EXPECT_NE(frame.find("\x1b[31m@"), string::npos);
+
+    ParallelRunner runner(3);
+    MapRenderer threaded(MapRenderer::Mode::TEXT, viewport);
+    threaded.setStyle(MapRenderer::Style::DENSITY);
+    threaded.setRunner(&runner);
+    threaded.setBounds(0, 100, 0, 100);
+    // Второй кадр считается в корзины прошлого — они должны обнуляться.
+    threaded.rasterize(world, world.front());
+    threaded.rasterize(world, world.front());
+    threaded.present("header", {});
+    for (size_t r = 0; r < viewport.height; r++) {
+        for (size_t c = 0; c < viewport.width; c++) {
+            EXPECT_EQ(threaded.binAt(c, r), serial.binAt(c, r));
+            EXPECT_EQ(threaded.cellAt(c, r), serial.cellAt(c, r));
+        }
+    }
+}
+
 TEST(FactoryTest, CreateNPC) {
     auto squirrel = NPCFactory::createNPC(NPCFactory::NPCType::SQUIRREL, 
                                          "TestSquirrel", 100, 200);
@@ -132,6 +285,179 @@ TEST(FactoryTest, CreateNPC) {
     EXPECT_EQ(druid->getType(), "Druid");
 }
 
+TEST(FactoryTest, SaveLoadKeepsTypes) {
+    vector<shared_ptr<NPC>> npcs;
+    npcs.push_back(NPCFactory::createNPC(NPCFactory::NPCType::WEREWOLF, "Wolf", 10, 20));
+    npcs.push_back(NPCFactory::createNPC(NPCFactory::NPCType::DRUID, "Dru", 30, 40));
+    
+    ASSERT_TRUE(NPCFactory::saveToFile(npcs, "test_save.txt"));
+    auto loaded = NPCFactory::loadFromFile("test_save.txt");
+    
+    ASSERT_EQ(loaded.size(), 2);
+    EXPECT_EQ(loaded[0]->getKind(), NPCKind::WEREWOLF);
+    EXPECT_EQ(loaded[1]->getKind(), NPCKind::DRUID);
+    EXPECT_EQ(loaded[1]->getName(), "Dru");
+}
+
+TEST(FactoryTest, BulkLoaderReportsBadLines) {
+    string filename = "test_bulk_load.txt";
+    {
+        ofstream file(filename);
+        file << "SQUIRREL,Nut,10.5,20.25\n"
+             << "WEREWOLF,Wolf,30,40\r\n"
+             << "\n"
+             << "DRUID,Dru,abc,1\n"
+             << "GOBLIN,Gob,1,1\n"
+             << "DRUID,Far,600,1\n"
+             << "DRUID,Oak, 7 , 8";
+    }
+    
+    NpcWorld world;
+    NPCFactory::LoadReport report;
+    ASSERT_TRUE(NPCFactory::loadIntoWorld(filename, world, NPCFactory::LoadOptions(), &report));
+    
+    EXPECT_EQ(report.loaded, 3u);
+    EXPECT_EQ(report.badLines, 3u);
+    EXPECT_EQ(report.badLineNumbers, (vector<size_t>{4, 5, 6}));
+    
+    ASSERT_EQ(world.size(), 3u);
+    EXPECT_EQ(world.kind(0), NPCKind::SQUIRREL);
+    EXPECT_EQ(world.name(0), "Nut");
+    EXPECT_DOUBLE_EQ(world.front().x[0], 10.5);
+    EXPECT_DOUBLE_EQ(world.front().y[0], 20.25);
+    EXPECT_EQ(world.kind(1), NPCKind::WEREWOLF);
+    EXPECT_DOUBLE_EQ(world.front().y[1], 40.0);
+    EXPECT_EQ(world.name(2), "Oak");
+    EXPECT_TRUE(world.isAlive(2));
+    
+    remove(filename.c_str());
+}
+
+// Файл больше 2 МиБ режется на несколько кусков: номера плохих строк
+// должны считаться от начала файла, а порядок NPC — совпадать с однопоточным.
+TEST(FactoryTest, BulkLoaderNumbersBadLinesAcrossChunks) {
+    string filename = "test_bulk_chunks.txt";
+    const size_t lineCount = 120000;
+    vector<size_t> expectedBad;
+    {
+        ofstream file(filename);
+        for (size_t i = 1; i <= lineCount; i++) {
+            if (i % 13331 == 0) {
+                file << "GOBLIN,Gob" << i << ",1,1\n";
+                expectedBad.push_back(i);
+            } else if (i % 9973 == 0) {
+                file << "\n";
+            } else {
+                file << "SQUIRREL,Sq" << i << "," << 1 + i % 400 << ".25," << 1 + i % 300 << ".5\n";
+            }
+        }
+    }
+    ifstream sized(filename, ios::binary | ios::ate);
+    ASSERT_GT(static_cast<size_t>(sized.tellg()), size_t(2) << 20);
+    
+    NPCFactory::LoadOptions options;
+    options.threads = 4;
+    NpcWorld world;
+    NPCFactory::LoadReport report;
+    ASSERT_TRUE(NPCFactory::loadIntoWorld(filename, world, options, &report));
+    
+    options.threads = 1;
+    NpcWorld single;
+    NPCFactory::LoadReport singleReport;
+    ASSERT_TRUE(NPCFactory::loadIntoWorld(filename, single, options, &singleReport));
+    
+    size_t blank = lineCount / 9973 - lineCount / (9973 * 13331);
+    EXPECT_EQ(report.badLines, expectedBad.size());
+    EXPECT_EQ(report.badLineNumbers, expectedBad);
+    EXPECT_EQ(report.loaded, lineCount - expectedBad.size() - blank);
+    EXPECT_EQ(singleReport.badLineNumbers, expectedBad);
+    ASSERT_EQ(world.size(), single.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < world.size(); i++) {
+        if (world.name(i) != single.name(i) || world.front().x[i] != single.front().x[i]) {
+            mismatches++;
+        }
+    }
+    EXPECT_EQ(mismatches, 0u);
+    
+    remove(filename.c_str());
+}
+
+TEST(FactoryTest, BinarySnapshotRoundTripAndCrc) {
+    string filename = "test_snapshot.bin";
+    NpcWorld world;
+    world.add(NPCKind::SQUIRREL, "Nut", 1.25, 2.5);
+    world.add(NPCKind::WEREWOLF, "", 300.0, 400.0);
+    world.add(NPCKind::DRUID, "Old Oak", 499.0, 0.5);
+    world.kill(1);
+    
+    ASSERT_TRUE(NPCFactory::saveSnapshot(world, filename));
+    
+    NpcWorld loaded;
+    ASSERT_TRUE(NPCFactory::loadSnapshot(filename, loaded));
+    ASSERT_EQ(loaded.size(), 3u);
+    for (size_t i = 0; i < world.size(); i++) {
+        EXPECT_EQ(loaded.kind(i), world.kind(i));
+        EXPECT_EQ(loaded.name(i), world.name(i));
+        EXPECT_EQ(loaded.isAlive(i), world.isAlive(i));
+        EXPECT_EQ(loaded.front().x[i], world.front().x[i]);
+        EXPECT_EQ(loaded.front().y[i], world.front().y[i]);
+    }
+    
+    {
+        fstream file(filename, ios::in | ios::out | ios::binary);
+        file.seekp(snapshot::HEADER_SIZE + 3);
+        file.put('\x7f');
+    }
+    NpcWorld corrupted;
+    EXPECT_FALSE(NPCFactory::loadSnapshot(filename, corrupted));
+    
+    uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(snapshot::crc32(check, sizeof(check)), 0xCBF43926u);
+    
+    remove(filename.c_str());
+}
+
+TEST(FactoryTest, SnapshotRejectsShortNameTable) {
+    NpcWorld world;
+    world.add(NPCKind::SQUIRREL, "Nut", 1.0, 2.0);
+    world.add(NPCKind::DRUID, "Oak", 3.0, 4.0);
+    vector<uint8_t> buffer;
+    snapshot::encodeWorld(world, buffer);
+    
+    // Последнее смещение меньше nameBytes, CRC пересчитан — хвост имён ничей
+    size_t count = world.size();
+    uint8_t* payload = buffer.data() + snapshot::HEADER_SIZE;
+    uint8_t* lastOffset = payload + count * 2 * sizeof(double) + count * sizeof(uint32_t);
+    uint32_t shortened = 4;
+    memcpy(lastOffset, &shortened, sizeof(shortened));
+    uint64_t payloadBytes;
+    memcpy(&payloadBytes, buffer.data() + 24, sizeof(payloadBytes));
+    uint32_t crc = snapshot::crc32(payload, payloadBytes);
+    memcpy(buffer.data() + 32, &crc, sizeof(crc));
+    
+    NpcWorld loaded;
+    string error;
+    EXPECT_FALSE(snapshot::decodeWorld(buffer, loaded, error));
+    EXPECT_EQ(error, "corrupt name table");
+}
+
+TEST(FactoryTest, SnapshotFromNpcsKeepsState) {
+    vector<shared_ptr<NPC>> npcs;
+    npcs.push_back(make_shared<Squirrel>("Nut", 10.0, 20.0));
+    npcs.push_back(make_shared<Druid>("Oak", 30.0, 40.0));
+    npcs[1]->setAlive(false);
+    
+    NpcWorld world;
+    world.addFrom(npcs);
+    ASSERT_EQ(world.size(), 2u);
+    EXPECT_EQ(world.name(0), "Nut");
+    EXPECT_EQ(world.front().x[1], 30.0);
+    EXPECT_EQ(world.front().y[1], 40.0);
+    EXPECT_TRUE(world.isAlive(0));
+    EXPECT_FALSE(world.isAlive(1));
+}
+
 TEST(FactoryTest, InvalidCoordinates) {
     auto npc = NPCFactory::createNPC(NPCFactory::NPCType::SQUIRREL, 
                                     "BadNPC", 0, 0);
@@ -189,6 +515,76 @@ TEST(BattleQueueTest, StopSignal) {
     EXPECT_FALSE(queue.tryGetTask(task));
     EXPECT_TRUE(queue.shouldStop());
 }
+TEST(BattleQueueTest, ShardedWorkStealing) {
+    BattleQueue queue(4);
+    auto npc1 = make_shared<Squirrel>("Sq1", 100, 100);
+    auto npc2 = make_shared<Werewolf>("Wolf1", 101, 101);
+    
+    for (size_t d = 0; d < 8; d++) {
+        queue.addTask(BattleTask(npc1, npc2, 100, d));
+    }
+    EXPECT_EQ(queue.shardCount(), 4);
+    EXPECT_EQ(queue.shardFor(BattleTask(npc1, npc2, 0, 5)), queue.shardFor(BattleTask(npc2, npc1, 7, 5)));
+    
+    BattleTask task;
+    ASSERT_TRUE(queue.tryGetTask(task, 1));
+    EXPECT_EQ(task.defenderId % 4, 1);
+    
+    size_t drained = 1;
+    while (queue.tryGetTask(task, 1)) {
+        drained++;
+    }
+    EXPECT_EQ(drained, 8);
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST(BattleQueueTest, BatchAddAndDrain) {
+    BattleQueue queue(3);
+    vector<BattleTask> batch;
+    for (size_t i = 0; i < 10; i++) {
+        batch.emplace_back(i, i + 100);
+    }
+    queue.addTasks(batch);
+    EXPECT_EQ(queue.size(), 10);
+    
+    vector<BattleTask> out;
+    EXPECT_EQ(queue.drainInto(out, 4, 0), 4);
+    EXPECT_EQ(queue.size(), 6);
+    EXPECT_EQ(queue.drainInto(out, 100, 2), 6);
+    EXPECT_EQ(out.size(), 10);
+    EXPECT_TRUE(queue.isEmpty());
+    
+    vector<size_t> defenders;
+    for (const auto& task : out) defenders.push_back(task.defenderId);
+    sort(defenders.begin(), defenders.end());
+    EXPECT_EQ(defenders.front(), 100);
+    EXPECT_EQ(defenders.back(), 109);
+}
+
+TEST(BattleQueueTest, CoalescesPairsAndDropsStale) {
+    BattleQueue queue(2, true);
+    vector<bool> alive = {true, true, true, true};
+    queue.setStaleFilter([&alive](const BattleTask& task) {
+        return !alive[task.attackerId] || !alive[task.defenderId];
+    });
+    
+    vector<BattleTask> batch = {BattleTask(0, 1), BattleTask(0, 1), BattleTask(2, 3)};
+    queue.addTasks(batch);
+    queue.addTask(BattleTask(2, 3));
+    EXPECT_EQ(queue.size(), 2);
+    EXPECT_EQ(queue.coalescedCount(), 2);
+    
+    alive[3] = false;
+    vector<BattleTask> out;
+    EXPECT_EQ(queue.drainInto(out, 10), 1);
+    EXPECT_EQ(out[0].attackerId, 0);
+    EXPECT_EQ(queue.staleDroppedCount(), 1);
+    EXPECT_TRUE(queue.isEmpty());
+    
+    queue.addTask(BattleTask(0, 1));
+    EXPECT_EQ(queue.size(), 1);
+}
+
 TEST(DetectionVisitorTest, DetectBattlesWithinRange) {
     vector<shared_ptr<NPC>> npcs;
     BattleQueue queue;
@@ -235,12 +631,167 @@ TEST(DetectionVisitorTest, DeadNPCNoDetection) {
     EXPECT_TRUE(queue.isEmpty());
 }
 
+TEST(SpatialGridTest, NeighbourQueryAndUpdate) {
+    SpatialGrid grid(0, 100, 0, 100, 10);
+    grid.insert(0, 5, 5);
+    grid.insert(1, 12, 8);
+    grid.insert(2, 80, 80);
+    
+    vector<size_t> found;
+    grid.forEachNear(6, 6, 10, [&](size_t id) { found.push_back(id); });
+    sort(found.begin(), found.end());
+    EXPECT_EQ(found, (vector<size_t>{0, 1}));
+    
+    grid.update(2, 7, 7);
+    grid.remove(1);
+    found.clear();
+    grid.forEachNear(6, 6, 10, [&](size_t id) { found.push_back(id); });
+    sort(found.begin(), found.end());
+    EXPECT_EQ(found, (vector<size_t>{0, 2}));
+}
+
+TEST(DetectionVisitorTest, GridMatchesFullScan) {
+    vector<shared_ptr<NPC>> npcs;
+    SpatialGrid grid(0, 500, 0, 500, 5);
+    
+    npcs.push_back(make_shared<Squirrel>("Sq", 100, 100));
+    npcs.push_back(make_shared<Werewolf>("Near", 103, 103));
+    npcs.push_back(make_shared<Druid>("Edge", 104.9, 100));
+    npcs.push_back(make_shared<Werewolf>("Far", 120, 100));
+    for (size_t i = 0; i < npcs.size(); i++) {
+        grid.insert(i, npcs[i]->getX(), npcs[i]->getY());
+    }
+    
+    BattleQueue scanQueue, gridQueue;
+    DetectionVisitor(npcs, scanQueue, npcs[0]).detectBattles();
+    DetectionVisitor(npcs, gridQueue, npcs[0], &grid).detectBattles();
+    
+    EXPECT_EQ(scanQueue.size(), 2);
+    EXPECT_EQ(gridQueue.size(), scanQueue.size());
+}
+
+TEST(NpcWorldTest, BuildFromNPCs) {
+    vector<shared_ptr<NPC>> npcs;
+    npcs.push_back(make_shared<Squirrel>("Sq", 10, 20));
+    npcs.push_back(make_shared<Werewolf>("Wolf", 30, 40));
+    npcs.push_back(make_shared<Druid>("Dru", 50, 60));
+    npcs[2]->setAlive(false);
+    
+    NpcWorld world;
+    world.addFrom(npcs);
+    
+    ASSERT_EQ(world.size(), 3);
+    EXPECT_EQ(world.name(1), "Wolf");
+    EXPECT_EQ(world.kind(1), NpcWorld::Kind::WEREWOLF);
+    EXPECT_DOUBLE_EQ(world.front().x[0], 10.0);
+    EXPECT_DOUBLE_EQ(world.front().y[1], 40.0);
+    EXPECT_FALSE(world.isAlive(2));
+    EXPECT_TRUE(world.canAttack(0, 1));
+    EXPECT_FALSE(world.canAttack(1, 0));
+    EXPECT_DOUBLE_EQ(world.traitsAt(1).moveDistance, 40.0);
+    EXPECT_DOUBLE_EQ(world.maxAttackDistance(), 10.0);
+}
+
+TEST(NpcWorldTest, AliveCountersTrackKills) {
+    NpcWorld world;
+    world.add(NPCKind::SQUIRREL, "S1", 1, 1);
+    world.add(NPCKind::SQUIRREL, "S2", 2, 2);
+    world.add(NPCKind::DRUID, "D1", 3, 3);
+    EXPECT_EQ(world.aliveCount(), 3u);
+    EXPECT_EQ(world.aliveCount(NPCKind::SQUIRREL), 2u);
+    
+    EXPECT_TRUE(world.kill(0));
+    EXPECT_FALSE(world.kill(0));
+    EXPECT_EQ(world.aliveCount(NPCKind::SQUIRREL), 1u);
+    EXPECT_EQ(world.aliveCount(NPCKind::DRUID), 1u);
+    EXPECT_EQ(world.aliveCount(NPCKind::WEREWOLF), 0u);
+    EXPECT_EQ(world.aliveCount(), 2u);
+    
+    world.clear();
+    EXPECT_EQ(world.aliveCount(), 0u);
+}
+
+TEST(NpcWorldTest, DoubleBufferAndKill) {
+    NpcWorld world;
+    world.add(NpcWorld::Kind::SQUIRREL, "Sq", 1, 2);
+    
+    world.back().x[0] = 5;
+    world.back().y[0] = 6;
+    EXPECT_DOUBLE_EQ(world.front().x[0], 1.0);
+    world.swapBuffers();
+    EXPECT_DOUBLE_EQ(world.readFront([](const NpcWorld::Positions& p) { return p.x[0]; }), 5.0);
+    
+    EXPECT_TRUE(world.kill(0));
+    EXPECT_FALSE(world.kill(0));
+    EXPECT_FALSE(world.isAlive(0));
+}
+
+TEST(SimdKernelsTest, BackendsAgreeWithScalar) {
+    const size_t COUNT = 37;
+    vector<double> srcX(COUNT), srcY(COUNT), dirX(COUNT), dirY(COUNT), step(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        srcX[i] = 3.0 * i;
+        srcY[i] = 100.0 - 2.5 * i;
+        dirX[i] = (i % 3 == 0) ? 0.0 : 0.3 * (static_cast<double>(i % 5) - 2.0);
+        dirY[i] = (i % 3 == 0) ? 0.0 : 0.7;
+        step[i] = (i % 4 == 0) ? 0.0 : 10.0;
+    }
+    simd::Bounds bounds{0.0, 100.0, 0.0, 100.0};
+    
+    simd::Backend original = simd::activeBackend();
+    ASSERT_TRUE(simd::setBackend(simd::Backend::SCALAR));
+    vector<double> refX(COUNT), refY(COUNT), refD(COUNT);
+    vector<uint32_t> refHits(COUNT);
+    simd::moveBlock(srcX.data(), srcY.data(), dirX.data(), dirY.data(), step.data(),
+                    refX.data(), refY.data(), COUNT, bounds);
+    simd::distancesSquared(50, 50, srcX.data(), srcY.data(), refD.data(), COUNT);
+    size_t refCount = simd::withinRadius(50, 50, srcX.data(), srcY.data(), COUNT, 400.0, refHits.data());
+    EXPECT_GT(refCount, 0);
+    
+    for (auto backend : {simd::Backend::SSE4, simd::Backend::AVX2}) {
+        if (!simd::setBackend(backend)) continue;
+        vector<double> outX(COUNT), outY(COUNT), outD(COUNT);
+        vector<uint32_t> hits(COUNT);
+        simd::moveBlock(srcX.data(), srcY.data(), dirX.data(), dirY.data(), step.data(),
+                        outX.data(), outY.data(), COUNT, bounds);
+        simd::distancesSquared(50, 50, srcX.data(), srcY.data(), outD.data(), COUNT);
+        size_t count = simd::withinRadius(50, 50, srcX.data(), srcY.data(), COUNT, 400.0, hits.data());
+        
+        for (size_t i = 0; i < COUNT; i++) {
+            EXPECT_NEAR(outX[i], refX[i], 1e-9) << simd::backendName(backend);
+            EXPECT_NEAR(outY[i], refY[i], 1e-9) << simd::backendName(backend);
+            EXPECT_DOUBLE_EQ(outD[i], refD[i]);
+        }
+        ASSERT_EQ(count, refCount);
+        EXPECT_TRUE(equal(hits.begin(), hits.begin() + count, refHits.begin()));
+    }
+    simd::setBackend(original);
+}
+
 TEST(ObserverTest, ConsoleLogger) {
     ConsoleLogger logger;
     logger.update("Test event");
     EXPECT_TRUE(true);
 }
 
+TEST(ObserverTest, ConsoleLoggerWaitsForConsoleLock) {
+    ConsoleMutex console;
+    ConsoleLogger logger(&console);
+    atomic<bool> printed{false};
+    console.lock();
+    thread printer([&] {
+        BattleEvent event;
+        event.killed = true;
+        logger.onBattle(event);
+        printed = true;
+    });
+    this_thread::sleep_for(chrono::milliseconds(20));
+    EXPECT_FALSE(printed);
+    console.unlock();
+    printer.join();
+    EXPECT_TRUE(printed);
+}
+
 TEST(ObserverTest, FileLoggerCreatesFile) {
     string filename = "test_log.txt";
     FileLogger logger(filename);
@@ -254,6 +805,243 @@ TEST(ObserverTest, FileLoggerCreatesFile) {
     remove(filename.c_str());
 }
 
+TEST(ObserverTest, AsyncWriterKeepsAllRecordsWhenBlocking) {
+    string filename = "test_async_log.txt";
+    remove(filename.c_str());
+    
+    AsyncLogWriter::Options options;
+    options.capacity = 16;
+    options.flushBytes = 512;
+    options.policy = AsyncLogWriter::OverflowPolicy::BLOCK;
+    
+    const int THREADS = 4;
+    const int PER_THREAD = 500;
+    {
+        AsyncLogWriter writer(filename, options);
+        ASSERT_TRUE(writer.isOpen());
+        
+        vector<thread> producers;
+        for (int t = 0; t < THREADS; t++) {
+            producers.emplace_back([&writer, t]() {
+                for (int i = 0; i < PER_THREAD; i++) {
+                    writer.push("worker " + to_string(t) + " event " + to_string(i) + "\n");
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        writer.flush();
+        
+        EXPECT_EQ(writer.writtenCount(), static_cast<size_t>(THREADS * PER_THREAD));
+        EXPECT_EQ(writer.droppedCount(), 0u);
+    }
+    
+    ifstream file(filename);
+    string line;
+    int lines = 0;
+    while (getline(file, line)) {
+        EXPECT_NE(line.find("] worker "), string::npos);
+        lines++;
+    }
+    EXPECT_EQ(lines, THREADS * PER_THREAD);
+    remove(filename.c_str());
+}
+
+TEST(ObserverTest, AsyncWriterMarksTruncatedRecords) {
+    string filename = "test_async_truncated.txt";
+    remove(filename.c_str());
+    
+    AsyncLogWriter::Options options;
+    options.flushInterval = chrono::milliseconds(10000);
+    {
+        AsyncLogWriter writer(filename, options);
+        ASSERT_TRUE(writer.isOpen());
+        writer.push(string(AsyncLogWriter::RECORD_TEXT_SIZE + 60, 'x'));
+        writer.push("short");
+        // Сброс будит спящего писателя, а не ждёт таймера.
+        auto start = chrono::steady_clock::now();
+        writer.flush();
+        EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(5));
+        EXPECT_EQ(writer.truncatedCount(), 1u);
+        EXPECT_EQ(writer.writtenCount(), 2u);
+    }
+    
+    ifstream file(filename);
+    string first, second;
+    ASSERT_TRUE(getline(file, first));
+    ASSERT_TRUE(getline(file, second));
+    string expected = string(AsyncLogWriter::RECORD_TEXT_SIZE, 'x') + string(AsyncLogWriter::TRUNCATED_MARK);
+    EXPECT_EQ(first.substr(first.find("] ") + 2), expected);
+    EXPECT_EQ(second.substr(second.find("] ") + 2), "short");
+    remove(filename.c_str());
+}
+
+TEST(ObserverTest, TypedEventsFormatOnlyForTextObservers) {
+    class TextObserver : public BattleObserver {
+    public:
+        vector<string> lines;
+        void update(const string& event) override { lines.push_back(event); }
+    };
+    
+    BattleLogger logger;
+    BattleStatsObserver stats;
+    TextObserver text;
+    logger.attach(&stats);
+    logger.attach(&text);
+    
+    string wolf = "Wolf_1";
+    string druid = "Druid_2";
+    BattleEvent event;
+    event.attackerId = 1;
+    event.defenderId = 2;
+    event.attackerKind = NPCKind::WEREWOLF;
+    event.defenderKind = NPCKind::DRUID;
+    event.attackerName = wolf;
+    event.defenderName = druid;
+    
+    event.killed = false;
+    logger.logBattleEvent(event);
+    event.killed = true;
+    logger.logBattleEvent(event);
+    
+    EXPECT_EQ(stats.battleCount(), 2u);
+    EXPECT_EQ(stats.killCount(), 1u);
+    EXPECT_EQ(stats.killsByKind(NPCKind::WEREWOLF), 1u);
+    EXPECT_EQ(stats.lossesOfKind(NPCKind::DRUID), 1u);
+    EXPECT_EQ(stats.lossesOfKind(NPCKind::WEREWOLF), 0u);
+    
+    ASSERT_EQ(text.lines.size(), 1u);
+    EXPECT_EQ(text.lines[0], "Wolf_1 (Werewolf) killed Druid_2 (Druid)");
+}
+
+TEST(ObserverTest, AttachDetachWhileNotifying) {
+    BattleLogger logger;
+    auto stats = make_shared<BattleStatsObserver>();
+    logger.attach(stats);
+    
+    atomic<bool> running{true};
+    vector<thread> notifiers;
+    for (int t = 0; t < 3; t++) {
+        notifiers.emplace_back([&]() {
+            BattleEvent event;
+            event.killed = true;
+            while (running) {
+                logger.logBattleEvent(event);
+            }
+        });
+    }
+    
+    for (int i = 0; i < 200; i++) {
+        auto temporary = make_shared<BattleStatsObserver>();
+        auto id = logger.attach(temporary);
+        EXPECT_EQ(logger.observerCount(), 2u);
+        EXPECT_TRUE(logger.detach(id));
+        EXPECT_FALSE(logger.detach(id));
+    }
+    while (stats->battleCount() == 0) {
+        this_thread::yield();
+    }
+    running = false;
+    for (auto& notifier : notifiers) notifier.join();
+    
+    EXPECT_EQ(logger.observerCount(), 1u);
+    EXPECT_GT(stats->battleCount(), 0u);
+    EXPECT_EQ(stats->battleCount(), stats->killCount());
+}
+
+TEST(ObserverTest, NestedNotifySeesUpdatedList) {
+    class Reentrant : public BattleObserver {
+    public:
+        BattleLogger& logger;
+        shared_ptr<BattleStatsObserver> stats;
+        int calls = 0;
+        Reentrant(BattleLogger& logger, shared_ptr<BattleStatsObserver> stats) : logger(logger), stats(stats) {}
+        void onBattle(const BattleEvent& event) override {
+            if (calls++ > 0) return;
+            logger.detach(this);
+            logger.attach(stats);
+            logger.logBattleEvent(event);
+        }
+    };
+    
+    BattleLogger logger;
+    auto stats = make_shared<BattleStatsObserver>();
+    Reentrant reentrant(logger, stats);
+    logger.attach(&reentrant);
+    
+    BattleEvent event;
+    logger.logBattleEvent(event);
+    EXPECT_EQ(reentrant.calls, 1);
+    EXPECT_EQ(stats->battleCount(), 1u);
+    
+    logger.logBattleEvent(event);
+    EXPECT_EQ(reentrant.calls, 1);
+    EXPECT_EQ(stats->battleCount(), 2u);
+}
+
+TEST(BattleLogTest, BinaryLogRoundTrip) {
+    string filename = "test_battle_log.bin";
+    BattleLogHeader header;
+    header.seed = 77;
+    header.maxX = 500000.0;
+    header.maxY = 250000.0;
+    
+    vector<BattleEvent> events;
+    for (uint32_t i = 0; i < 100; i++) {
+        BattleEvent event;
+        event.tick = 1 + i / 10;
+        event.attackerId = 1000 + i * 7;
+        event.defenderId = i * 13;
+        event.attackerKind = NPCKind::SQUIRREL;
+        event.defenderKind = (i % 2) ? NPCKind::WEREWOLF : NPCKind::DRUID;
+        event.attackRoll = static_cast<uint8_t>(1 + i % 6);
+        event.defenseRoll = static_cast<uint8_t>(1 + (i / 6) % 6);
+        event.killed = event.attackRoll > event.defenseRoll && i % 5 != 0;
+        event.targetAlreadyDead = event.attackRoll > event.defenseRoll && !event.killed;
+        // Большая карта: 16-битное квантование дало бы шаг около 8 единиц.
+        event.attackerX = i * 4900.3;
+        event.attackerY = i * 2300.7;
+        event.defenderX = i * 4900.3 + 1.25;
+        event.defenderY = i * 2300.7 + 1.25;
+        events.push_back(event);
+    }
+    
+    BattleEventWriter writer;
+    ASSERT_TRUE(writer.open(filename, header));
+    for (size_t i = events.size(); i-- > 0;) {
+        writer.append(events[i]);
+    }
+    writer.close();
+    EXPECT_EQ(writer.eventCount(), events.size());
+    EXPECT_LT(writer.bytesWritten(), events.size() * 26);
+    
+    BattleEventReader reader;
+    ASSERT_TRUE(reader.open(filename));
+    EXPECT_EQ(reader.header().seed, 77u);
+    EXPECT_DOUBLE_EQ(reader.header().maxX, 500000.0);
+    
+    BattleEvent decoded;
+    size_t count = 0;
+    while (reader.next(decoded)) {
+        ASSERT_LT(count, events.size());
+        const BattleEvent& original = events[count];
+        EXPECT_EQ(decoded.tick, original.tick);
+        EXPECT_EQ(decoded.attackerId, original.attackerId);
+        EXPECT_EQ(decoded.defenderId, original.defenderId);
+        EXPECT_EQ(decoded.defenderKind, original.defenderKind);
+        EXPECT_EQ(decoded.attackRoll, original.attackRoll);
+        EXPECT_EQ(decoded.defenseRoll, original.defenseRoll);
+        EXPECT_EQ(decoded.killed, original.killed);
+        EXPECT_EQ(decoded.targetAlreadyDead, original.targetAlreadyDead);
+        EXPECT_NEAR(decoded.attackerX, original.attackerX, 0.05);
+        EXPECT_NEAR(decoded.defenderX - decoded.attackerX, 1.25, 0.1);
+        EXPECT_NEAR(decoded.defenderY, original.defenderY, 0.05);
+        count++;
+    }
+    EXPECT_EQ(count, events.size());
+    
+    remove(filename.c_str());
+}
+
 TEST(ObserverTest, BattleLoggerNotifiesMultiple) {
     BattleLogger logger;
     
@@ -280,11 +1068,378 @@ TEST(ObserverTest, BattleLoggerNotifiesMultiple) {
     EXPECT_EQ(obs1.lastMsg, "Test");
 }
 
+TEST(TickSchedulerTest, RunsPhasesInOrder) {
+    TickScheduler scheduler(0.0);
+    vector<string> trace;
+    scheduler.setPhase(TickPhase::OBSERVE, [&](uint64_t tick) { trace.push_back("observe" + to_string(tick)); });
+    scheduler.setPhase(TickPhase::MOVE, [&](uint64_t tick) { trace.push_back("move" + to_string(tick)); });
+    scheduler.setPhase(TickPhase::RESOLVE, [&](uint64_t tick) { trace.push_back("resolve" + to_string(tick)); });
+    
+    atomic<bool> running{true};
+    EXPECT_EQ(scheduler.run(2, running), 2);
+    EXPECT_EQ(trace, (vector<string>{"move1", "resolve1", "observe1", "move2", "resolve2", "observe2"}));
+    EXPECT_EQ(scheduler.currentTick(), 2);
+    EXPECT_EQ(scheduler.getStats().overruns, 0);
+}
+
+TEST(TickSchedulerTest, ReportsOverrun) {
+    TickScheduler scheduler(200.0);
+    scheduler.setPhase(TickPhase::DETECT, [](uint64_t tick) {
+        if (tick == 2) this_thread::sleep_for(chrono::milliseconds(20));
+    });
+    
+    atomic<bool> running{true};
+    scheduler.run(3, running);
+    auto stats = scheduler.getStats();
+    EXPECT_EQ(stats.ticks, 3);
+    EXPECT_GE(stats.overruns, 1);
+    EXPECT_DOUBLE_EQ(stats.budgetMs, 5.0);
+    EXPECT_GE(stats.maxPhaseMs[static_cast<size_t>(TickPhase::DETECT)], 20.0);
+}
+
+TEST(TickSchedulerTest, TickRateChangesWhileRunning) {
+    TickScheduler scheduler(0.0);
+    atomic<bool> running{true};
+    thread changer([&scheduler] {
+        for (int i = 0; i < 100; i++) {
+            scheduler.setTickRate(i % 2 ? 0.0 : 100000.0);
+        }
+        scheduler.setTickRate(1000.0);
+    });
+    EXPECT_EQ(scheduler.run(500, running), 500);
+    changer.join();
+    EXPECT_DOUBLE_EQ(scheduler.getTickRate(), 1000.0);
+    EXPECT_DOUBLE_EQ(scheduler.getStats().budgetMs, 1.0);
+}
+
+TEST(ProfilerTest, HistogramPercentilesWithinPrecision) {
+    LatencyHistogram histogram;
+    // 1..1000 мкс по одному разу: p50 = 500 мкс, p99 = 990 мкс.
+    for (uint64_t us = 1; us <= 1000; us++) {
+        histogram.record(us * 1000);
+    }
+    LatencyHistogram::Counts counts;
+    histogram.addTo(counts);
+    auto summary = LatencyHistogram::summarize(counts);
+    double precision = 1.0 / LatencyHistogram::SUB_BUCKETS;
+    EXPECT_EQ(summary.count, 1000u);
+    EXPECT_NEAR(summary.p50Us, 500.0, 500.0 * precision);
+    EXPECT_NEAR(summary.p99Us, 990.0, 990.0 * precision);
+    EXPECT_DOUBLE_EQ(summary.maxUs, 1000.0);
+    EXPECT_DOUBLE_EQ(summary.meanUs, 500.5);
+    for (uint64_t v : {0ull, 31ull, 32ull, 1000ull, 123456789ull, ~0ull}) {
+        EXPECT_GE(LatencyHistogram::bucketValue(LatencyHistogram::bucketIndex(v)), v);
+    }
+
+    // Окно между снимками видит только новые значения.
+    histogram.record(5000000);
+    LatencyHistogram::Counts later;
+    histogram.addTo(later);
+    auto window = LatencyHistogram::summarize(later.since(counts));
+    EXPECT_EQ(window.count, 1u);
+    EXPECT_NEAR(window.p50Us, 5000.0, 5000.0 * precision);
+}
+
+TEST(ProfilerTest, EngineRecordsEveryPhase) {
+    GameConfig config;
+    config.headless = true;
+    config.npcCount = 500;
+    config.ticks = 30;
+    config.tickRate = 0.0;
+    config.hasSeed = true;
+    config.seed = 7;
+    config.logFile.clear();
+
+    GameEngine engine(config);
+    engine.initializeGame();
+    engine.run();
+
+    auto profile = engine.getProfile();
+    for (auto point : {ProfilePoint::MOVE, ProfilePoint::DETECT, ProfilePoint::RESOLVE,
+                       ProfilePoint::OBSERVE, ProfilePoint::TICK}) {
+        EXPECT_EQ(profile[static_cast<size_t>(point)].count, 30u) << profilePointName(point);
+    }
+    const auto& tick = profile[static_cast<size_t>(ProfilePoint::TICK)];
+    EXPECT_LE(tick.p50Us, tick.p99Us);
+    EXPECT_LE(tick.p99Us, tick.maxUs);
+    EXPECT_GT(profile[static_cast<size_t>(ProfilePoint::BATTLE)].count, 0u);
+    EXPECT_GT(profile[static_cast<size_t>(ProfilePoint::QUEUE_WAIT)].count, 0u);
+}
+
+TEST(TraceTest, WritesChromeTraceEvents) {
+    string filename = "test_trace.json";
+    trace::start();
+    {
+        trace::Span span("outer");
+    }
+    thread worker([] {
+        trace::setThreadName("worker");
+        trace::Span span("inner");
+    });
+    worker.join();
+    trace::stop();
+    {
+        trace::Span ignored("after_stop");
+    }
+    ASSERT_TRUE(trace::writeChromeJson(filename));
+
+    ifstream file(filename);
+    string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find("\"name\":\"outer\",\"ph\":\"X\""), string::npos);
+    EXPECT_NE(json.find("\"name\":\"inner\",\"ph\":\"X\""), string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker\"}"), string::npos);
+    EXPECT_EQ(json.find("after_stop"), string::npos);
+    EXPECT_EQ(trace::droppedCount(), 0u);
+    remove(filename.c_str());
+}
+
+TEST(TraceTest, RingsAreCreatedLazilyAndReused) {
+    trace::stop();
+    size_t before = trace::ringCount();
+    thread idle([] {
+        trace::setThreadName("idle");
+        trace::Span span("not_recording");
+    });
+    idle.join();
+    EXPECT_EQ(trace::ringCount(), before);
+
+    auto spawnWorkers = [] {
+        for (int i = 0; i < 2; i++) {
+            thread worker([] { trace::Span span("work"); });
+            worker.join();
+        }
+    };
+    trace::start();
+    spawnWorkers();
+    trace::stop();
+    size_t afterFirst = trace::ringCount();
+    EXPECT_LE(afterFirst, before + 2);
+
+    trace::start();
+    spawnWorkers();
+    trace::stop();
+    EXPECT_EQ(trace::ringCount(), afterFirst);
+}
+
+TEST(LockStatsTest, InstrumentedMutexCountsContention) {
+    static_assert(lockstats::ENABLED != is_same_v<ProfiledMutex<LockClass::NPC>, mutex>);
+
+    InstrumentedMutex<LockClass::CONSOLE> mtx;
+    auto before = lockstats::snapshot();
+    atomic<bool> held{false};
+    mtx.lock();
+    thread waiter([&] {
+        held.wait(false);
+        lock_guard<InstrumentedMutex<LockClass::CONSOLE>> lock(mtx);
+    });
+    held = true;
+    held.notify_one();
+    this_thread::sleep_for(chrono::milliseconds(50));
+    mtx.unlock();
+    waiter.join();
+    EXPECT_TRUE(mtx.try_lock());
+    mtx.unlock();
+
+    auto used = lockstats::since(lockstats::snapshot(), before)[static_cast<size_t>(LockClass::CONSOLE)];
+    EXPECT_EQ(used.acquisitions, 3u);
+    EXPECT_EQ(used.contended, 1u);
+    EXPECT_GT(used.waitNs, 0u);
+    EXPECT_NE(lockstats::toJson(lockstats::snapshot()).find("\"console\":{\"acquired\":"), string::npos);
+}
+
 TEST(GameEngineTest, Initialization) {
     GameEngine engine;
     EXPECT_TRUE(true);
 }
 
+TEST(GameEngineTest, HeadlessSeededRunIsReproducible) {
+    GameConfig config;
+    config.headless = true;
+    config.npcCount = 300;
+    config.ticks = 50;
+    config.tickRate = 0.0;
+    config.hasSeed = true;
+    config.seed = 1234;
+    config.threads = 1;
+    config.logFile.clear();
+    
+    GameEngine first(config);
+    first.initializeGame();
+    first.run();
+    
+    GameEngine second(config);
+    second.initializeGame();
+    second.run();
+    
+    EXPECT_EQ(first.getTick(), 50);
+    EXPECT_GT(first.getKillCount(), 0);
+    EXPECT_EQ(first.getKillCount(), second.getKillCount());
+}
+
+TEST(GameEngineTest, ParallelPhasesMatchSingleThread) {
+    GameConfig config;
+    config.headless = true;
+    config.npcCount = 10000;
+    config.mapMaxX = 1000.0;
+    config.mapMaxY = 1000.0;
+    config.ticks = 20;
+    config.tickRate = 0.0;
+    config.hasSeed = true;
+    config.seed = 5;
+    config.logFile.clear();
+    config.profileEvery = 0;
+
+    config.phaseThreads = 1;
+    GameEngine serial(config);
+    serial.initializeGame();
+    serial.run();
+
+    config.phaseThreads = 4;
+    GameEngine parallel(config);
+    parallel.initializeGame();
+    parallel.run();
+
+    EXPECT_GT(serial.getKillCount(), 0u);
+    EXPECT_EQ(serial.getKillCount(), parallel.getKillCount());
+    const NpcWorld& a = serial.getWorld();
+    const NpcWorld& b = parallel.getWorld();
+    ASSERT_EQ(a.size(), b.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a.isAlive(i) != b.isAlive(i) || a.front().x[i] != b.front().x[i] || a.front().y[i] != b.front().y[i]) {
+            mismatches++;
+        }
+    }
+    EXPECT_EQ(mismatches, 0u);
+}
+
+TEST(ParallelRunnerTest, RunsEveryChunkOnce) {
+    ParallelRunner runner(4);
+    EXPECT_EQ(runner.threadCount(), 4u);
+    for (size_t round = 0; round < 200; round++) {
+        size_t chunks = round % 17;
+        vector<atomic<int>> hits(chunks);
+        runner.run(chunks, [&](size_t chunk) { hits[chunk]++; });
+        for (size_t c = 0; c < chunks; c++) {
+            ASSERT_EQ(hits[c].load(), 1) << "round " << round << " chunk " << c;
+        }
+    }
+}
+
+TEST(ParallelRunnerTest, WakesOnlyNeededWorkers) {
+    ParallelRunner runner(8);
+    EXPECT_EQ(runner.threadCount(), 8u);
+    EXPECT_EQ(runner.startedWorkers(), 0u);
+    
+    runner.run(1, [](size_t) {});
+    EXPECT_EQ(runner.startedWorkers(), 0u);
+    
+    mutex idsMutex;
+    set<thread::id> ids;
+    auto record = [&](size_t) {
+        this_thread::sleep_for(chrono::milliseconds(2));
+        lock_guard<mutex> lock(idsMutex);
+        ids.insert(this_thread::get_id());
+    };
+    runner.run(3, record);
+    EXPECT_EQ(runner.startedWorkers(), 2u);
+    EXPECT_LE(ids.size(), 3u);
+    
+    for (int round = 0; round < 20; round++) {
+        ids.clear();
+        runner.run(2, record);
+        EXPECT_LE(ids.size(), 2u);
+    }
+    EXPECT_EQ(runner.startedWorkers(), 2u);
+    
+    runner.run(50, [](size_t) {});
+    EXPECT_EQ(runner.startedWorkers(), 7u);
+}
+
+TEST(GameEngineTest, ResumeFromCheckpointIsBitIdentical) {
+    string filename = "test_checkpoint.bin";
+    GameConfig config;
+    config.headless = true;
+    config.npcCount = 2000;
+    config.mapMaxX = 300.0;
+    config.mapMaxY = 300.0;
+    config.tickRate = 0.0;
+    config.hasSeed = true;
+    config.seed = 99;
+    config.threads = 4;
+    config.logFile.clear();
+    
+    config.ticks = 40;
+    GameEngine straight(config);
+    straight.initializeGame();
+    straight.run();
+    
+    config.ticks = 15;
+    config.checkpointFile = filename;
+    GameEngine first(config);
+    first.initializeGame();
+    first.run();
+    
+    config.ticks = 40;
+    config.checkpointFile.clear();
+    config.resumeFile = filename;
+    config.seed = 1;
+    GameEngine resumed(config);
+    resumed.initializeGame();
+    EXPECT_EQ(resumed.getTick(), 15u);
+    EXPECT_EQ(resumed.getKillCount(), first.getKillCount());
+    resumed.run();
+    
+    auto countMismatches = [&straight](const GameEngine& engine) {
+        const NpcWorld& a = straight.getWorld();
+        const NpcWorld& b = engine.getWorld();
+        size_t mismatches = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a.isAlive(i) != b.isAlive(i) || a.front().x[i] != b.front().x[i] || a.front().y[i] != b.front().y[i]) {
+                mismatches++;
+            }
+        }
+        return mismatches;
+    };
+    
+    EXPECT_EQ(resumed.getTick(), 40u);
+    EXPECT_EQ(resumed.getSeed(), 99u);
+    EXPECT_EQ(resumed.getKillCount(), straight.getKillCount());
+    ASSERT_EQ(straight.getWorld().size(), resumed.getWorld().size());
+    EXPECT_EQ(countMismatches(resumed), 0u);
+    
+    // Периодическая точка на последнем тике и запрошенная на первом пишутся
+    // из фазы наблюдения — номер тика должен совпасть с сохранённым состоянием.
+    string requestedFile = "test_checkpoint_requested.bin";
+    config.ticks = 10;
+    config.checkpointFile = filename;
+    config.checkpointEvery = 5;
+    config.resumeFile.clear();
+    config.seed = 99;
+    GameEngine periodic(config);
+    periodic.initializeGame();
+    periodic.requestCheckpoint(requestedFile);
+    periodic.run();
+    
+    config.ticks = 40;
+    config.checkpointFile.clear();
+    config.checkpointEvery = 0;
+    for (const auto& [file, tick] : {make_pair(filename, 10u), make_pair(requestedFile, 1u)}) {
+        config.resumeFile = file;
+        GameEngine again(config);
+        again.initializeGame();
+        EXPECT_EQ(again.getTick(), tick);
+        again.run();
+        EXPECT_EQ(again.getKillCount(), straight.getKillCount());
+        ASSERT_EQ(straight.getWorld().size(), again.getWorld().size());
+        EXPECT_EQ(countMismatches(again), 0u);
+    }
+    
+    remove(filename.c_str());
+    remove(requestedFile.c_str());
+}
+
 TEST(IntegrationTest, CompleteBattleScenario) {
     vector<shared_ptr<NPC>> npcs;
     BattleQueue queue;
@@ -493,6 +1648,42 @@ TEST(RandomnessTest, MovementRandomness) {
     EXPECT_TRUE(moved) << "NPC didn't move after 10 attempts";
 }
 
+TEST(RandomnessTest, PhiloxKnownAnswers) {
+    auto zero = Philox4x32::generate({0, 0, 0, 0}, {0, 0});
+    EXPECT_EQ(zero, (Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    
+    auto pi = Philox4x32::generate({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0});
+    EXPECT_EQ(pi, (Philox4x32::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(RandomnessTest, StreamsAreReproducibleAndIndependent) {
+    RngStream a = RngService::stream(42, RngDomain::MOVEMENT, 7, 100);
+    RngStream b = RngService::stream(42, RngDomain::MOVEMENT, 7, 100);
+    RngStream other = RngService::stream(42, RngDomain::MOVEMENT, 8, 100);
+    
+    bool differs = false;
+    for (int i = 0; i < 64; i++) {
+        uint32_t value = a();
+        EXPECT_EQ(value, b());
+        differs = differs || value != other();
+    }
+    EXPECT_TRUE(differs);
+    
+    RngStream skipped = RngService::stream(42, RngDomain::MOVEMENT, 7, 101);
+    RngStream sequential = RngService::stream(42, RngDomain::MOVEMENT, 7, 100);
+    for (int i = 0; i < 4; i++) sequential();
+    EXPECT_EQ(skipped(), sequential());
+    
+    for (int i = 0; i < 1000; i++) {
+        double u = a.uniform();
+        EXPECT_GE(u, 0.0);
+        EXPECT_LT(u, 1.0);
+        int roll = NPC::rollDice(a);
+        EXPECT_GE(roll, 1);
+        EXPECT_LE(roll, 6);
+    }
+}
+
 TEST(GameLogicTest, SquirrelCanKillWerewolf) {
     Squirrel squirrel("Sq", 100, 100);
     Werewolf wolf("Wolf", 101, 101);
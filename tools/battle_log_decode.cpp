@@ -0,0 +1,48 @@
+#include "../include/battle_log.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            csv = true;
+        } else if (filename.empty() && arg[0] != '-') {
+            filename = arg;
+        } else {
+            filename.clear();
+            break;
+        }
+    }
+    if (filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--csv] FILE" << std::endl;
+        return 1;
+    }
+
+    BattleEventReader reader;
+    if (!reader.open(filename)) {
+        return 1;
+    }
+
+    const auto& header = reader.header();
+    if (csv) {
+        std::cout << battleEventCsvHeader() << '\n';
+    } else {
+        std::cout << "# battle log v" << header.version << ", seed " << header.seed
+                  << ", map [" << header.minX << ", " << header.maxX << "] x ["
+                  << header.minY << ", " << header.maxY << "]\n";
+    }
+
+    BattleEvent event;
+    size_t count = 0;
+    while (reader.next(event)) {
+        std::cout << (csv ? formatBattleEventCsv(event) : formatBattleEvent(event)) << '\n';
+        count++;
+    }
+    if (!csv) {
+        std::cout << "# " << count << " events\n";
+    }
+    return 0;
+}